@@ -84,7 +84,7 @@ struct User {
     std::string id;
     std::string name;
     std::string email;
-    std::string password; // Plain text for now, should be hashed in production
+    std::string password; // PBKDF2 hash (see password_hash.h); plain text in legacy records
     std::string created_at;
 
     NLOHMANN_DEFINE_TYPE_INTRUSIVE(User, id, name, email, password, created_at)
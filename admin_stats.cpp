@@ -0,0 +1,47 @@
+#include "admin_stats.h"
+
+using namespace std;
+
+void AdminStats::bump_route(const string& route, int delta) {
+    int& count = route_counts[route];
+    if (count > 0) route_rank.erase({-count, route});
+    count += delta;
+    if (count > 0) route_rank.insert({-count, route});
+    else route_counts.erase(route);
+}
+
+void AdminStats::booking_confirmed(const Booking& b) {
+    confirmed++;
+    total_revenue += b.total_price;
+    per_user[b.user_id]++;
+    bump_route(route_key(b.from_code, b.to_code), +1);
+}
+
+void AdminStats::booking_withdrawn(const Booking& b) {
+    confirmed--;
+    total_revenue -= b.total_price;
+    auto it = per_user.find(b.user_id);
+    if (it != per_user.end() && --it->second == 0) per_user.erase(it);
+    bump_route(route_key(b.from_code, b.to_code), -1);
+}
+
+void AdminStats::flight_added(int price) {
+    prices.insert(price);
+}
+
+void AdminStats::flight_removed(int price) {
+    auto it = prices.find(price);
+    if (it != prices.end()) prices.erase(it);
+}
+
+void AdminStats::clear() {
+    *this = AdminStats();
+}
+
+json AdminStats::top_routes(size_t n) const {
+    json routes = json::array();
+    for (auto it = route_rank.begin(); it != route_rank.end() && routes.size() < n; ++it) {
+        routes.push_back({{"route", it->second}, {"count", -it->first}});
+    }
+    return routes;
+}
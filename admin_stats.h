@@ -0,0 +1,49 @@
+#ifndef ADMIN_STATS_H
+#define ADMIN_STATS_H
+
+#include <string>
+#include <set>
+#include <utility>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+#include "Models.h"
+
+using json = nlohmann::json;
+
+// ==============================
+// ADMIN STATISTICS
+// ==============================
+// Dashboard aggregates kept up to date by the store's mutation hooks, so
+// reading them costs O(top-N) instead of a pass over every booking and
+// flight. Only confirmed bookings count; cancelling one takes it back out.
+class AdminStats {
+public:
+    void booking_confirmed(const Booking& b);
+    void booking_withdrawn(const Booking& b);    // a confirmed booking was cancelled
+    void flight_added(int price);
+    void flight_removed(int price);
+    void clear();
+
+    long long confirmed_bookings() const { return confirmed; }
+    long long revenue() const { return total_revenue; }
+    size_t distinct_customers() const { return per_user.size(); }
+    int cheapest_price() const { return prices.empty() ? 0 : *prices.begin(); }
+    int expensive_price() const { return prices.empty() ? 0 : *prices.rbegin(); }
+
+    // Most booked routes, ties broken alphabetically: [{"route", "count"}]
+    json top_routes(size_t n) const;
+
+    static std::string route_key(const std::string& from, const std::string& to) { return from + " → " + to; }
+
+private:
+    long long confirmed = 0;
+    long long total_revenue = 0;
+    std::unordered_map<std::string, int> per_user;        // user_id -> confirmed bookings
+    std::unordered_map<std::string, int> route_counts;    // "A → B" -> confirmed bookings
+    std::set<std::pair<int, std::string>> route_rank;     // (-count, route): begin() is the top route
+    std::multiset<int> prices;                            // live flight prices
+
+    void bump_route(const std::string& route, int delta);
+};
+
+#endif
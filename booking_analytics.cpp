@@ -0,0 +1,169 @@
+#include "booking_analytics.h"
+#include "admin_stats.h"
+#include <algorithm>
+
+using namespace std;
+
+static const char* const DIMENSION_NAMES[] = {"day", "route", "airline", "flight"};
+
+bool BookingAnalytics::parse_dimension(const string& name, Dimension& out) {
+    for (int d = 0; d < NUM_DIMENSIONS; ++d) {
+        if (name == DIMENSION_NAMES[d]) { out = (Dimension)d; return true; }
+    }
+    return false;
+}
+
+// ==========================================
+// UPDATES
+// ==========================================
+
+string BookingAnalytics::booking_day(const Booking& b) {
+    // booking_date is "YYYY-MM-DD HH:MM"
+    return b.booking_date.substr(0, 10);
+}
+
+BookingAnalytics::Counters BookingAnalytics::contribution(const Booking& b, int sign) {
+    Counters c;
+    c.bookings = sign;
+    if (b.status == "confirmed") {
+        c.confirmed = sign;
+        c.revenue = (int64_t)sign * b.total_price;
+    } else if (b.status == "cancelled") {
+        c.cancelled = sign;
+    }
+    return c;
+}
+
+int32_t BookingAnalytics::intern(Table& t, const string& key) {
+    auto it = t.key_ids.find(key);
+    if (it != t.key_ids.end()) return it->second;
+    int32_t id = (int32_t)t.keys.size();
+    t.key_ids.emplace(key, id);
+    t.keys.push_back(key);
+    t.totals.emplace_back();
+    return id;
+}
+
+void BookingAnalytics::apply(Table& t, int32_t key, const string& day, const Counters& delta) {
+    t.totals[key].add(delta);
+
+    DayColumn& col = t.days[day];
+    auto it = lower_bound(col.keys.begin(), col.keys.end(), key);
+    size_t pos = it - col.keys.begin();
+    if (it == col.keys.end() || *it != key) {
+        col.keys.insert(it, key);
+        col.values.insert(col.values.begin() + pos, Counters());
+    }
+    col.values[pos].add(delta);
+}
+
+void BookingAnalytics::apply_booking(size_t row, const Booking& b, int sign) {
+    Counters delta = contribution(b, sign);
+    string day = booking_day(b);
+
+    apply(tables[BY_DAY], intern(tables[BY_DAY], day), day, delta);
+    apply(tables[BY_ROUTE], intern(tables[BY_ROUTE], AdminStats::route_key(b.from_code, b.to_code)), day, delta);
+    apply(tables[BY_AIRLINE], booking_airline[row], day, delta);
+    apply(tables[BY_FLIGHT], intern(tables[BY_FLIGHT], b.flight_id), day, delta);
+}
+
+void BookingAnalytics::booking_added(size_t row, const Booking& b, const string& airline) {
+    if (booking_airline.size() <= row) booking_airline.resize(row + 1, -1);
+    booking_airline[row] = intern(tables[BY_AIRLINE], airline.empty() ? "Unknown" : airline);
+    apply_booking(row, b, +1);
+}
+
+void BookingAnalytics::booking_changed(size_t row, const Booking& before, const Booking& after) {
+    if (row >= booking_airline.size() || booking_airline[row] < 0) return;
+    apply_booking(row, before, -1);
+    apply_booking(row, after, +1);
+}
+
+void BookingAnalytics::clear() {
+    for (auto& t : tables) t = Table();
+    booking_airline.clear();
+}
+
+// ==========================================
+// QUERIES
+// ==========================================
+
+static json group_json(const string& key, const BookingAnalytics::Counters& c, bool per_flight) {
+    json g = {
+        {"key", key},
+        {"bookings", c.bookings},
+        {"confirmed", c.confirmed},
+        {"cancelled", c.cancelled},
+        {"revenue", c.revenue},
+        {"cancellation_rate", c.bookings ? (double)c.cancelled / c.bookings : 0.0}
+    };
+    if (per_flight) {
+        g["seats"] = BookingAnalytics::SEATS_PER_FLIGHT;
+        g["load_factor"] = (double)c.confirmed / BookingAnalytics::SEATS_PER_FLIGHT;
+    }
+    return g;
+}
+
+json BookingAnalytics::query(Dimension dim, const string& from_day, const string& to_day, size_t limit) const {
+    const Table& t = tables[dim];
+
+    // (key id, counters) for every key with bookings in the range
+    vector<pair<int32_t, Counters>> groups;
+    if (from_day.empty() && to_day.empty()) {
+        for (size_t k = 0; k < t.totals.size(); ++k) {
+            if (t.totals[k].bookings) groups.emplace_back((int32_t)k, t.totals[k]);
+        }
+    } else {
+        auto first = from_day.empty() ? t.days.begin() : t.days.lower_bound(from_day);
+        auto last = to_day.empty() ? t.days.end() : t.days.upper_bound(to_day);
+        // key id -> position in 'groups'; one int per key is cheaper than hashing
+        vector<int32_t> slot(t.keys.size(), -1);
+        for (auto it = first; it != last; ++it) {
+            const DayColumn& col = it->second;
+            for (size_t i = 0; i < col.keys.size(); ++i) {
+                int32_t& s = slot[col.keys[i]];
+                if (s < 0) {
+                    s = (int32_t)groups.size();
+                    groups.emplace_back(col.keys[i], Counters());
+                }
+                groups[s].second.add(col.values[i]);
+            }
+        }
+        groups.erase(remove_if(groups.begin(), groups.end(),
+                               [](const pair<int32_t, Counters>& g) { return g.second.bookings == 0; }),
+                     groups.end());
+    }
+
+    Counters totals;
+    for (const auto& g : groups) totals.add(g.second);
+
+    size_t shown = min(limit, groups.size());
+    if (dim == BY_DAY) {
+        auto by_day = [&](const pair<int32_t, Counters>& a, const pair<int32_t, Counters>& b) {
+            return t.keys[a.first] < t.keys[b.first];
+        };
+        sort(groups.begin(), groups.end(), by_day);
+    } else {
+        auto by_revenue = [&](const pair<int32_t, Counters>& a, const pair<int32_t, Counters>& b) {
+            if (a.second.revenue != b.second.revenue) return a.second.revenue > b.second.revenue;
+            return t.keys[a.first] < t.keys[b.first];
+        };
+        partial_sort(groups.begin(), groups.begin() + shown, groups.end(), by_revenue);
+    }
+
+    json out = json::array();
+    for (size_t i = 0; i < shown; ++i) {
+        out.push_back(group_json(t.keys[groups[i].first], groups[i].second, dim == BY_FLIGHT));
+    }
+
+    json totals_json = group_json("", totals, false);
+    totals_json.erase("key");
+    return {
+        {"group_by", DIMENSION_NAMES[dim]},
+        {"from", from_day},
+        {"to", to_day},
+        {"totals", totals_json},
+        {"total_groups", groups.size()},
+        {"groups", out}
+    };
+}
@@ -0,0 +1,88 @@
+#ifndef BOOKING_ANALYTICS_H
+#define BOOKING_ANALYTICS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+#include "Models.h"
+
+using json = nlohmann::json;
+
+// ==============================
+// BOOKING ANALYTICS
+// ==============================
+// Pre-aggregated booking counters for the admin analytics page, updated
+// by the store's booking hooks instead of recomputed from the history.
+//
+// Every booking lands in one bucket per (dimension key, booking day):
+//
+//   dimension   key                  e.g.
+//   day         booking day          "2025-12-01"
+//   route       from → to            "DEL → BOM"
+//   airline     airline of flight_id "IndiGo"   (as at booking time)
+//   flight      flight_id            "FL1002"
+//
+// Keys are interned per dimension and each day holds a column of
+// (key id, counters) sorted by key id. An unbounded query reads the
+// per-key totals; a date-range query walks only the day columns inside
+// the range, so its cost depends on the distinct keys booked per day,
+// not on the number of bookings.
+class BookingAnalytics {
+public:
+    enum Dimension { BY_DAY, BY_ROUTE, BY_AIRLINE, BY_FLIGHT, NUM_DIMENSIONS };
+
+    // The Flight model has no seat count; load factor assumes a single-aisle cabin
+    static constexpr int SEATS_PER_FLIGHT = 180;
+
+    struct Counters {
+        int64_t bookings = 0;      // every booking made, whatever its status
+        int64_t confirmed = 0;
+        int64_t cancelled = 0;
+        int64_t revenue = 0;       // confirmed bookings only
+
+        void add(const Counters& o) {
+            bookings += o.bookings; confirmed += o.confirmed;
+            cancelled += o.cancelled; revenue += o.revenue;
+        }
+    };
+
+    // 'row' is the booking's row in the store; its airline is remembered
+    // so a later status change is booked against the same buckets
+    void booking_added(size_t row, const Booking& b, const std::string& airline);
+    void booking_changed(size_t row, const Booking& before, const Booking& after);
+    void clear();
+
+    static bool parse_dimension(const std::string& name, Dimension& out);
+
+    // Groups for bookings made in [from_day, to_day] (inclusive,
+    // "YYYY-MM-DD", empty = unbounded). Days come back in date order, the
+    // other dimensions by revenue (descending), at most 'limit' groups.
+    json query(Dimension dim, const std::string& from_day, const std::string& to_day, size_t limit) const;
+
+private:
+    struct DayColumn {
+        std::vector<int32_t> keys;           // ascending key ids
+        std::vector<Counters> values;
+    };
+
+    struct Table {
+        std::vector<std::string> keys;                       // key id -> key
+        std::unordered_map<std::string, int32_t> key_ids;
+        std::vector<Counters> totals;                        // key id -> all-time counters
+        std::map<std::string, DayColumn> days;               // booking day -> column
+    };
+
+    Table tables[NUM_DIMENSIONS];
+    std::vector<int32_t> booking_airline;                    // booking row -> BY_AIRLINE key id
+
+    int32_t intern(Table& t, const std::string& key);
+    void apply(Table& t, int32_t key, const std::string& day, const Counters& delta);
+    void apply_booking(size_t row, const Booking& b, int sign);
+    static Counters contribution(const Booking& b, int sign);
+    static std::string booking_day(const Booking& b);
+};
+
+#endif
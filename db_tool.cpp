@@ -0,0 +1,33 @@
+#include "jsondb.h"
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// ==========================================
+// DATABASE TOOL
+// ==========================================
+// JSON import/export for the binary snapshot the server runs on.
+// <database> is the same path the server opens ("flight_database.json");
+// stop the server first, both would otherwise own the WAL.
+//
+//   db_tool export <database> <out.json>   snapshot + WAL -> JSON
+//   db_tool import <database> <in.json>    JSON -> new snapshot (replaces all records)
+
+int main(int argc, char* argv[]) {
+    string cmd = argc > 1 ? argv[1] : "";
+    if (argc != 4 || (cmd != "export" && cmd != "import")) {
+        cerr << "usage: db_tool export <database> <out.json>" << endl;
+        cerr << "       db_tool import <database> <in.json>" << endl;
+        return 2;
+    }
+
+    JsonDB db(argv[2]);
+    bool ok = cmd == "export" ? db.export_json(argv[3]) : db.import_json(argv[3]);
+    if (!ok) {
+        cerr << "[ERROR] " << cmd << " failed for " << argv[3] << endl;
+        return 1;
+    }
+    cout << "[INFO] " << (cmd == "export" ? "Exported to " : "Imported from ") << argv[3] << endl;
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include "flight_graph.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <atomic>
+
+using namespace std;
+
+static atomic<uint64_t> next_lineage{1};
+
+// ==========================================
+// INTERNING
+// ==========================================
+
+template <typename T>
+void FlightGraph::append(TableView<T>& view, T value) {
+    // A graph behind the lineage's tip would overwrite what a newer one appended
+    if (view.count != view.table->size()) throw logic_error("FlightGraph: only the newest graph may intern");
+    view.table->push_back(move(value));
+    view.count++;
+}
+
+int FlightGraph::find_airport(const string& code) const {
+    auto it = airport_index->find(code);
+    return it == airport_index->end() ? -1 : it->second;
+}
+
+int FlightGraph::intern_airport(const string& code) {
+    int found = find_airport(code);
+    if (found >= 0) return found;
+
+    int idx = (int)airports.size();
+    append(airports, code);
+    auto next = make_shared<unordered_map<string, int32_t>>(*airport_index);
+    (*next)[code] = idx;
+    airport_index = move(next);
+
+    // New origin row goes after all existing rows: empty buckets
+    if (offsets.empty()) offsets.push_back(0);
+    offsets.insert(offsets.end(), num_days, (uint32_t)edges.size());
+    return idx;
+}
+
+int32_t FlightGraph::intern_airline(const string& name) {
+    auto& index = writer_indexes->airlines;
+    auto it = index.find(name);
+    if (it != index.end()) return it->second;
+
+    int32_t idx = (int32_t)airlines.size();
+    append(airlines, name);
+    index[name] = idx;
+    return idx;
+}
+
+int32_t FlightGraph::intern_flight(const string& id, int32_t airline, int32_t origin) {
+    // Entries are never rewritten (older graphs may be reading them), so a
+    // re-added flight keeps its slot only if nothing about it changed
+    auto& index = writer_indexes->flights;
+    auto it = index.find(id);
+    if (it != index.end() && flights[it->second].airline == airline && flights[it->second].origin == origin) {
+        return it->second;
+    }
+
+    int32_t idx = (int32_t)flights.size();
+    append(flights, FlightInfo{id, airline, origin});
+    index[id] = idx;
+    return idx;
+}
+
+void FlightGraph::restore_names(const vector<string>& airport_codes, const vector<string>& airline_names,
+                                const vector<FlightInfo>& flight_infos) {
+    airports = {};
+    airlines = {};
+    flights = {};
+    writer_indexes = make_shared<WriterIndexes>();
+    auto airport_map = make_shared<unordered_map<string, int32_t>>();
+
+    for (const auto& code : airport_codes) {
+        (*airport_map)[code] = (int32_t)airports.size();
+        append(airports, code);
+    }
+    for (const auto& name : airline_names) {
+        writer_indexes->airlines[name] = (int32_t)airlines.size();
+        append(airlines, name);
+    }
+    writer_indexes->flights.reserve(flight_infos.size());
+    for (const auto& f : flight_infos) {
+        writer_indexes->flights[f.id] = (int32_t)flights.size();  // a later slot is the current one
+        append(flights, f);
+    }
+    airport_index = move(airport_map);
+    lineage = next_lineage++;
+}
+
+// ==========================================
+// INCREMENTAL MAINTENANCE
+// ==========================================
+
+void FlightGraph::relayout(int new_first_day, int new_num_days) {
+    // Re-bucket existing edges into a wider day range (counting sort;
+    // relative order inside each bucket is preserved).
+    vector<uint32_t> new_offsets((size_t)airports.size() * new_num_days + 1, 0);
+    for (size_t o = 0; o < airports.size(); ++o) {
+        for (int d = 0; d < num_days; ++d) {
+            size_t b = o * num_days + d;
+            size_t nb = o * new_num_days + (first_day + d - new_first_day);
+            new_offsets[nb + 1] = offsets[b + 1] - offsets[b];
+        }
+    }
+    for (size_t i = 1; i < new_offsets.size(); ++i) new_offsets[i] += new_offsets[i - 1];
+
+    // Buckets keep their relative order, so the edge array itself is unchanged
+    first_day = new_first_day;
+    num_days = new_num_days;
+    offsets.swap(new_offsets);
+}
+
+void FlightGraph::build(const vector<FlightLeg>& legs) {
+    *this = FlightGraph();
+    lineage = next_lineage++;
+    if (legs.empty()) return;
+
+    int lo = legs[0].dep / 1440, hi = lo;
+    for (const auto& l : legs) {
+        intern_airport(l.from);
+        intern_airport(l.to);
+        lo = min(lo, l.dep / 1440);
+        hi = max(hi, l.dep / 1440);
+    }
+    first_day = lo;
+    num_days = hi - lo + 1;
+
+    // Counting sort into (origin, day) buckets
+    vector<size_t> bucket_of(legs.size());
+    offsets.assign(airports.size() * num_days + 1, 0);
+    for (size_t i = 0; i < legs.size(); ++i) {
+        bucket_of[i] = bucket(find_airport(legs[i].from), legs[i].dep / 1440);
+        offsets[bucket_of[i] + 1]++;
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) offsets[i] += offsets[i - 1];
+
+    edges.resize(legs.size());
+    vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < legs.size(); ++i) {
+        const auto& l = legs[i];
+        int32_t origin = find_airport(l.from);
+        int32_t flight = intern_flight(l.flight_id, intern_airline(l.airline), origin);
+        edges[cursor[bucket_of[i]]++] = {find_airport(l.to), l.dep, l.arr, l.weight_minutes, l.price, flight};
+    }
+
+    for (size_t b = 0; b + 1 < offsets.size(); ++b) {
+        stable_sort(edges.begin() + offsets[b], edges.begin() + offsets[b + 1],
+                    [](const Edge& x, const Edge& y) { return x.dep < y.dep; });
+    }
+
+    connections.reserve(edges.size());
+    for (size_t o = 0; o < airports.size(); ++o) {
+        for (uint32_t i = offsets[o * num_days]; i < offsets[(o + 1) * num_days]; ++i) {
+            connections.push_back({(int32_t)o, edges[i]});
+        }
+    }
+    stable_sort(connections.begin(), connections.end(),
+                [](const Connection& x, const Connection& y) { return x.edge.dep < y.edge.dep; });
+}
+
+void FlightGraph::insert(const FlightLeg& leg) {
+    int origin = intern_airport(leg.from);
+    int dest = intern_airport(leg.to);
+
+    int day = leg.dep / 1440;
+    if (num_days == 0) {
+        relayout(day, 1);
+    } else if (day < first_day) {
+        relayout(day, num_days + (first_day - day));
+    } else if (day >= first_day + num_days) {
+        relayout(first_day, day - first_day + 1);
+    }
+
+    int32_t flight = intern_flight(leg.flight_id, intern_airline(leg.airline), origin);
+    Edge e{dest, leg.dep, leg.arr, leg.weight_minutes, leg.price, flight};
+
+    size_t b = bucket(origin, day);
+    auto first = edges.begin() + offsets[b];
+    auto last = edges.begin() + offsets[b + 1];
+    auto pos = upper_bound(first, last, e, [](const Edge& x, const Edge& y) { return x.dep < y.dep; });
+    edges.insert(pos, e);
+    for (size_t i = b + 1; i < offsets.size(); ++i) offsets[i]++;
+
+    Connection c{origin, e};
+    connections.insert(upper_bound(connections.begin(), connections.end(), c,
+                                   [](const Connection& x, const Connection& y) { return x.edge.dep < y.edge.dep; }),
+                       c);
+}
+
+int FlightGraph::remove(const string& flight_id) {
+    auto f = writer_indexes->flights.find(flight_id);
+    if (f == writer_indexes->flights.end()) return -1;
+    int32_t flight_ref = f->second;
+    int origin = flights[flight_ref].origin;
+
+    // The origin's row covers every day; scan it for this flight's edge
+    for (int d = 0; d < num_days; ++d) {
+        size_t b = (size_t)origin * num_days + d;
+        for (uint32_t i = offsets[b]; i < offsets[b + 1]; ++i) {
+            if (edges[i].flight != flight_ref) continue;
+            int dep = edges[i].dep;
+            edges.erase(edges.begin() + i);
+            for (size_t j = b + 1; j < offsets.size(); ++j) offsets[j]--;
+
+            // Same departure time locates it in the timetable
+            auto c = lower_bound(connections.begin(), connections.end(), dep,
+                                 [](const Connection& x, int t) { return x.edge.dep < t; });
+            while (c != connections.end() && c->edge.flight != flight_ref) ++c;
+            if (c != connections.end()) connections.erase(c);
+            return dep;
+        }
+    }
+    return -1;
+}
+
+pair<const Edge*, const Edge*> FlightGraph::slice(int origin, int day) const {
+    if (origin < 0 || origin >= (int)airports.size() || day < first_day || day >= first_day + num_days) {
+        return {nullptr, nullptr};
+    }
+    size_t b = bucket(origin, day);
+    return {edges.data() + offsets[b], edges.data() + offsets[b + 1]};
+}
+
+// ==========================================
+// TIME HELPERS
+// ==========================================
+
+// Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's algorithm)
+static int days_from_civil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int)doe - 719468;
+}
+
+static int days_in_month(int y, int m) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    return m == 2 && leap ? 29 : days[m - 1];
+}
+
+int FlightGraph::parse_date(const string& ymd) {
+    int y, m, d;
+    if (sscanf(ymd.c_str(), "%d-%d-%d", &y, &m, &d) != 3) return -1;
+    // Impossible dates (2025-02-30) would otherwise roll into the next month
+    if (y < 1 || y > 9999 || m < 1 || m > 12 || d < 1 || d > days_in_month(y, m)) return -1;
+    return days_from_civil(y, m, d);
+}
+
+int FlightGraph::parse_schedule_date(const string& ymd) {
+    int day = parse_date(ymd);
+    if (day < 0) return -1;
+    int today = (int)(time(nullptr) / 86400);
+    int window = SCHEDULE_WINDOW_YEARS * 366;
+    return day < today - window || day > today + window ? -1 : day;
+}
+
+int FlightGraph::parse_clock(const string& hhmm) {
+    int h, m;
+    if (sscanf(hhmm.c_str(), "%d:%d", &h, &m) != 2) return -1;
+    if (h < 0 || h > 23 || m < 0 || m > 59) return -1;
+    return h * 60 + m;
+}
+
+string FlightGraph::format_date(int day) {
+    int z = day + 719468;
+    const int era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int y = (int)yoe + era * 400;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%04d-%02u-%02u", y + (m <= 2), m, d);
+    return buf;
+}
+
+string FlightGraph::format_clock(int minutes) {
+    minutes %= 1440;
+    if (minutes < 0) minutes += 1440;
+    char buf[8];
+    snprintf(buf, sizeof(buf), "%02d:%02d", minutes / 60, minutes % 60);
+    return buf;
+}
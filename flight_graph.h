@@ -0,0 +1,173 @@
+#ifndef FLIGHT_GRAPH_H
+#define FLIGHT_GRAPH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+// Internal Edge Structure for Graph Algorithms
+// Plain integers only: airports and flights are interned, times are
+// minutes since 1970-01-01 00:00 so they compare across midnight.
+struct Edge {
+    int32_t destination;     // airport index
+    int32_t dep;             // departure, minutes since epoch
+    int32_t arr;             // arrival, minutes since epoch
+    int32_t weight_minutes;  // scheduled duration
+    int32_t price;
+    int32_t flight;          // index into FlightGraph::flights
+};
+
+// An edge together with its origin, for the global timetable
+struct Connection {
+    int32_t origin;
+    Edge edge;
+};
+
+// Side table for the strings an Edge refers to (only read when a
+// result is materialised as JSON).
+struct FlightInfo {
+    std::string id;
+    int32_t airline;         // index into FlightGraph::airlines
+    int32_t origin;          // airport index, needed to locate the bucket
+};
+
+// One flight as handed to the graph (already parsed to integers)
+struct FlightLeg {
+    std::string from;
+    std::string to;
+    std::string flight_id;
+    std::string airline;
+    int dep;
+    int arr;
+    int weight_minutes;
+    int price;
+};
+
+// ==============================
+// SHARED NAME TABLES
+// ==============================
+// Interned names are append-only and shared by every graph of one
+// lineage, so patching a graph copies its edge arrays but no strings.
+// Entries live in fixed chunks that never move and are never rewritten:
+// a graph reads its own prefix [0, size) while the newest graph of the
+// lineage appends past it.
+template <typename T>
+class AppendOnlyTable {
+public:
+    static const size_t CHUNK = 1024;
+    static const size_t MAX_CHUNKS = 16384;     // 16M entries
+
+    AppendOnlyTable() : chunks(new std::unique_ptr<T[]>[MAX_CHUNKS]) {}
+
+    const T& operator[](size_t i) const { return chunks[i / CHUNK][i % CHUNK]; }
+    size_t size() const { return count; }
+
+    void push_back(T value) {
+        if (count == CHUNK * MAX_CHUNKS) throw std::length_error("AppendOnlyTable is full");
+        if (count % CHUNK == 0) chunks[count / CHUNK].reset(new T[CHUNK]);
+        chunks[count / CHUNK][count % CHUNK] = std::move(value);
+        count++;
+    }
+
+private:
+    std::unique_ptr<std::unique_ptr<T[]>[]> chunks;
+    size_t count = 0;
+};
+
+// One graph's view of a shared table: the entries it was made with
+template <typename T>
+class TableView {
+public:
+    const T& operator[](size_t i) const { return (*table)[i]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    friend class FlightGraph;
+    std::shared_ptr<AppendOnlyTable<T>> table = std::make_shared<AppendOnlyTable<T>>();
+    size_t count = 0;
+};
+
+// ==============================
+// CSR FLIGHT GRAPH
+// ==============================
+// All edges live in one contiguous array, bucketed by (origin, day) and
+// sorted by departure inside each bucket:
+//
+//   edges[offsets[b] .. offsets[b + 1])   with   b = origin * num_days + day
+//
+// so a search for one date only ever touches its own slice.
+// 'connections' holds the same flights as one timetable sorted by
+// departure, for scan-based algorithms (Connection Scan).
+//
+// Copies are cheap apart from the edge arrays: names are shared (see
+// above). Only the newest graph of a lineage may be patched.
+class FlightGraph {
+public:
+    TableView<std::string> airports;             // index -> code
+    TableView<std::string> airlines;             // index -> name
+    TableView<FlightInfo> flights;               // index -> id/airline/origin
+
+    int first_day = 0;                           // day number of bucket column 0
+    int num_days = 0;
+    std::vector<uint32_t> offsets;               // airports.size() * num_days + 1
+    std::vector<Edge> edges;
+    std::vector<Connection> connections;         // all edges, sorted by departure
+
+    // New on every bulk build / restore; insert() and remove() keep it, so
+    // an interned index means the same thing in every graph of one lineage
+    // (a flight re-added with another airline or origin gets a new index)
+    uint64_t lineage = 0;
+
+    int find_airport(const std::string& code) const;
+    int intern_airport(const std::string& code);
+
+    // Bulk load (counting sort into buckets, then sort by departure)
+    void build(const std::vector<FlightLeg>& legs);
+
+    // Incremental maintenance. insert() keeps buckets sorted by departure;
+    // both shift the tail of 'edges' instead of rebuilding the layout.
+    void insert(const FlightLeg& leg);
+    int remove(const std::string& flight_id);    // -> departure of the removed edge, -1 if none
+
+    // Binary snapshot: starts a new lineage from the stored name tables
+    void restore_names(const std::vector<std::string>& airport_codes, const std::vector<std::string>& airline_names,
+                       const std::vector<FlightInfo>& flight_infos);
+
+    // Edges leaving 'origin' on 'day' (both as indexes/day numbers)
+    std::pair<const Edge*, const Edge*> slice(int origin, int day) const;
+
+    static const int SCHEDULE_WINDOW_YEARS = 5;
+
+    // Time helpers
+    static int parse_date(const std::string& ymd);          // -> day number, -1 if invalid
+    // parse_date limited to SCHEDULE_WINDOW_YEARS either side of today: the
+    // dates flights may be scheduled on and searched for. Keeps the bucket
+    // rows (airports x days) short and minute timestamps far from overflow.
+    static int parse_schedule_date(const std::string& ymd);
+    static int parse_clock(const std::string& hhmm);        // -> minutes of day, -1 if invalid
+    static std::string format_date(int day);
+    static std::string format_clock(int minutes);
+
+private:
+    // Read by searches on any graph: replaced, not modified, when an airport is added
+    std::shared_ptr<const std::unordered_map<std::string, int32_t>> airport_index =
+        std::make_shared<std::unordered_map<std::string, int32_t>>();
+    // Only used while patching, i.e. by the newest graph: shared by the lineage
+    struct WriterIndexes {
+        std::unordered_map<std::string, int32_t> airlines;
+        std::unordered_map<std::string, int32_t> flights;  // every id ever inserted -> latest index
+    };
+    std::shared_ptr<WriterIndexes> writer_indexes = std::make_shared<WriterIndexes>();
+
+    size_t bucket(int origin, int day) const { return (size_t)origin * num_days + (day - first_day); }
+    void relayout(int new_first_day, int new_num_days);
+    int32_t intern_airline(const std::string& name);
+    int32_t intern_flight(const std::string& id, int32_t airline, int32_t origin);
+    template <typename T> static void append(TableView<T>& view, T value);
+};
+
+#endif
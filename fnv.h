@@ -0,0 +1,27 @@
+#ifndef FNV_H
+#define FNV_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// FNV-1a 64 folded over 8-byte words (bytewise for the tail): one
+// multiply per word. Used for snapshot checksums and ETags; not
+// a cryptographic hash.
+inline uint64_t fnv1a64(const char* p, size_t n) {
+    uint64_t h = 14695981039346656037ULL;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h ^= w;
+        h *= 1099511628211ULL;
+    }
+    for (; i < n; ++i) {
+        h ^= (unsigned char)p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+#endif
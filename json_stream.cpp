@@ -0,0 +1,105 @@
+#include "json_stream.h"
+#include <cstdio>
+
+using namespace std;
+
+void append_json(string& out, const string& s) {
+    out += '"';
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += (char)c;
+                }
+        }
+    }
+    out += '"';
+}
+
+static void append_field(string& out, const char* key, const string& value, bool first = false) {
+    if (!first) out += ',';
+    out += '"';
+    out += key;
+    out += "\":";
+    append_json(out, value);
+}
+
+static void append_field(string& out, const char* key, long long value, bool first = false) {
+    if (!first) out += ',';
+    out += '"';
+    out += key;
+    out += "\":";
+    out += to_string(value);
+}
+
+static void append_field(string& out, const char* key, double value, bool first = false) {
+    if (!first) out += ',';
+    out += '"';
+    out += key;
+    out += "\":";
+    // Airports only: reuse nlohmann's shortest round-trip formatting
+    out += json(value).dump();
+}
+
+// Keys below are in the order nlohmann's (sorted) object emits them
+
+void append_json(string& out, const Airport& a) {
+    out += '{';
+    append_field(out, "city", a.city, true);
+    append_field(out, "code", a.code);
+    append_field(out, "id", (long long)a.id);
+    append_field(out, "lat", a.lat);
+    append_field(out, "long", a.lng);
+    append_field(out, "name", a.name);
+    out += '}';
+}
+
+void append_json(string& out, const Flight& f) {
+    out += '{';
+    append_field(out, "airline", f.airline, true);
+    append_field(out, "arrival", f.arrival);
+    append_field(out, "date", f.date);
+    append_field(out, "departure", f.departure);
+    append_field(out, "duration", f.duration);
+    append_field(out, "from_code", f.from_code);
+    append_field(out, "id", f.id);
+    append_field(out, "price", (long long)f.price);
+    append_field(out, "to_code", f.to_code);
+    out += '}';
+}
+
+void append_json(string& out, const Booking& b) {
+    out += '{';
+    append_field(out, "booking_date", b.booking_date, true);
+    append_field(out, "booking_id", b.booking_id);
+    append_field(out, "date", b.date);
+    append_field(out, "flight_id", b.flight_id);
+    append_field(out, "from_code", b.from_code);
+    append_field(out, "passenger_email", b.passenger_email);
+    append_field(out, "passenger_name", b.passenger_name);
+    append_field(out, "status", b.status);
+    append_field(out, "to_code", b.to_code);
+    append_field(out, "total_price", (long long)b.total_price);
+    append_field(out, "user_id", b.user_id);
+    out += '}';
+}
+
+void append_json(string& out, const User& u) {
+    out += '{';
+    append_field(out, "created_at", u.created_at, true);
+    append_field(out, "email", u.email);
+    append_field(out, "id", u.id);
+    append_field(out, "name", u.name);
+    out += '}';
+}
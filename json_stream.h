@@ -0,0 +1,35 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <string>
+#include <vector>
+#include "Models.h"
+
+// ==============================
+// DIRECT JSON SERIALISERS
+// ==============================
+// Append one model as JSON straight from the typed record, without
+// building an intermediate nlohmann tree. The output matches what
+// json(record).dump() produces (keys in sorted order, same escaping), so
+// list endpoints can be built as one string while the store is locked.
+
+void append_json(std::string& out, const std::string& s);   // quoted and escaped
+void append_json(std::string& out, const Airport& a);
+void append_json(std::string& out, const Flight& f);
+void append_json(std::string& out, const Booking& b);
+void append_json(std::string& out, const User& u);            // without the password
+
+// "[r0,r1,...]" for rows[i] of 'records' (all of them if rows == nullptr)
+template <class T>
+void append_json_array(std::string& out, const std::vector<T>& records,
+                       const std::vector<size_t>* rows = nullptr) {
+    out += '[';
+    size_t n = rows ? rows->size() : records.size();
+    for (size_t i = 0; i < n; ++i) {
+        if (i) out += ',';
+        append_json(out, records[rows ? (*rows)[i] : i]);
+    }
+    out += ']';
+}
+
+#endif
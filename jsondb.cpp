@@ -1,10 +1,16 @@
 #include "jsondb.h"
+#include "json_stream.h"
+#include "password_hash.h"
 #include <fstream>
 #include <iostream>
 #include <queue>
+#include <algorithm>
+#include <climits>
 #include <set>
 #include <cstdlib> 
 #include <ctime>   
+#include <chrono>
+#include <filesystem>
 #include <mutex> // <--- Added explicit include to fix 'mutex not declared'
 
 using namespace std;
@@ -13,26 +19,194 @@ using namespace std;
 // CONSTRUCTOR & HELPERS
 // ==========================================
 
-JsonDB::JsonDB(const string& fname) : filename(fname) {
-    ifstream file(filename);
-    if (file.is_open()) {
-        try { file >> data; } catch (...) { data = json::object(); }
+// Compact once this many records have accumulated, or on a timer.
+static const size_t WAL_COMPACT_RECORDS = 5000;
+static const chrono::minutes WAL_COMPACT_INTERVAL(10);
+
+// Earliest-arrival scans stop this far past 00:00 of the requested date
+static const int CSA_HORIZON_MINUTES = 48 * 60;
+// Upper bound on rounds for the multi-criteria search
+static const int PARETO_MAX_STOPS = 4;
+// Routes listed in the admin stats' top_routes
+static const size_t ADMIN_TOP_ROUTES = 5;
+// Cap on the groups returned by one analytics query
+static const int ANALYTICS_MAX_GROUPS = 1000;
+// Password hashes waiting for a worker before signups/logins are refused
+static const size_t AUTH_QUEUE_LIMIT = 64;
+// Tuples a multi-city merge may pop before giving up on further results
+static const size_t MULTICITY_MAX_EXPANSIONS = 4096;
+// Search sub-tasks waiting for a helper before callers run them inline
+static const size_t SEARCH_QUEUE_LIMIT = 256;
+// Distinct search strings whose flight totals are remembered
+static const size_t FLIGHT_COUNT_CACHE = 1024;
+
+JsonDB::JsonDB(const string& fname)
+    : filename(fname), snapshot_path(fname + ".snap"), wal(fname + ".wal"),
+      hash_iterations(PasswordHash::configured_iterations()),
+      auth_pool(thread::hardware_concurrency(), AUTH_QUEUE_LIMIT),
+      search_pool(thread::hardware_concurrency(), SEARCH_QUEUE_LIMIT),
+      route_table([this] { return graph_snapshot(); }) {
+    // Prefer the binary snapshot: records and graph come back without a parse
+    uint64_t snapshot_seq = 0;
+    auto loaded = make_shared<FlightGraph>();
+    bool from_binary = BinarySnapshot::load(snapshot_path, store, *loaded, snapshot_seq);
+
+    if (!from_binary && ifstream(snapshot_path).good()) {
+        // Unreadable: keep it aside for inspection instead of overwriting it
+        error_code ec;
+        filesystem::rename(snapshot_path, snapshot_path + ".corrupt", ec);
+        cerr << "[ERROR] Moved unreadable snapshot to " << snapshot_path << ".corrupt" << endl;
     }
-    
-    // If file is empty or missing data, generate it
-    if (data.empty() || !data.contains("airports")) {
-        seed_data();
+
+    if (!from_binary) {
+        // First start on a JSON database (or none at all): import or seed,
+        // then convert below so the next start takes the fast path
+        json snapshot;
+        ifstream file(filename);
+        if (file.is_open()) {
+            try { file >> snapshot; } catch (...) { snapshot = json::object(); }
+        }
+
+        // If file is empty or missing data, generate it
+        if (!snapshot.is_object() || !snapshot.contains("airports")) {
+            seed_data();
+        } else {
+            store.load(snapshot);
+            snapshot_seq = snapshot.value("wal_seq", (uint64_t)0);
+            cout << "[INFO] Imported " << filename << endl;
+        }
     }
+
+    // Roll forward anything logged since the snapshot was taken
+    auto apply = [this](const string& op, const json& payload) { apply_record(op, payload); };
+    replaying = true;
+    uint64_t last_seq = WriteAheadLog::replay(filename + ".wal.1", snapshot_seq, apply);
+    last_seq = max(last_seq, WriteAheadLog::replay(filename + ".wal", snapshot_seq, apply));
+    replaying = false;
+    publish_airports();
     
-    // Always build the graph for the algorithm on startup
-    build_graph();
+    // The stored graph is only current if nothing was replayed on top of it
+    if (from_binary && last_seq == snapshot_seq) {
+        atomic_store(&graph, shared_ptr<const FlightGraph>(move(loaded)));
+    } else {
+        build_graph();
+    }
+    route_table.rebuild_all();
+
+    wal.start(last_seq);
+    if (!from_binary) compact();
+    compactor = thread(&JsonDB::compaction_loop, this);
+}
+
+JsonDB::~JsonDB() {
+    {
+        lock_guard<mutex> lock(compact_mutex);
+        stopping = true;
+    }
+    compact_cv.notify_all();
+    if (compactor.joinable()) compactor.join();
+
+    // Leave a snapshot with a current graph behind for a fast restart
+    if (wal.pending_records() > 0) compact();
+}
+
+// ==========================================
+// WAL: MUTATION LOG & COMPACTION
+// ==========================================
+
+bool JsonDB::mutate(const string& op, const json& payload) {
+    uint64_t seq;
+    {
+        unique_lock<shared_mutex> lock(db_mutex);
+        if (!apply_record(op, payload)) return false;
+        seq = wal.append(op, payload);
+    }
+    // Wait for the group commit outside the lock so other requests proceed.
+    // If it never lands, the change is in memory only: report failure.
+    if (!wal.wait_durable(seq)) return false;
+
+    if (wal.pending_records() >= WAL_COMPACT_RECORDS) compact_cv.notify_one();
+    return true;
 }
 
-void JsonDB::save() {
-    ofstream file(filename);
-    file << data.dump(4);
-    // Rebuild graph whenever data changes
-    build_graph();
+void JsonDB::compaction_loop() {
+    unique_lock<mutex> lock(compact_mutex);
+    while (!stopping) {
+        compact_cv.wait_for(lock, WAL_COMPACT_INTERVAL);
+        if (stopping) break;
+        if (wal.pending_records() == 0) continue;
+
+        lock.unlock();
+        compact();
+        lock.lock();
+    }
+}
+
+void JsonDB::compact() {
+    // Also called from startup, shutdown and import_json()
+    lock_guard<mutex> serial(snapshot_mutex);
+    string snapshot;
+    {
+        // Shared is enough: every append happens under the exclusive lock,
+        // so none can race the rotation, while searches keep running.
+        shared_lock<shared_mutex> lock(db_mutex);
+        uint64_t seq = wal.rotate();
+        snapshot = BinarySnapshot::encode(store, *graph_snapshot(), seq);
+    }
+
+    // Slow disk write happens without holding db_mutex
+    if (WriteAheadLog::write_atomically(snapshot_path, snapshot)) {
+        wal.discard_rotated();
+    } else {
+        cerr << "[ERROR] Compaction failed, keeping rotated WAL segment" << endl;
+    }
+}
+
+// ==========================================
+// RECORD APPLICATION
+// ==========================================
+// WAL payloads stay JSON; they are converted to the typed models here.
+
+bool JsonDB::apply_record(const string& op, const json& payload) {
+    try {
+        if (op == "add_airport" || op == "delete_airport" || op == "update_airport") {
+            bool ok = op == "add_airport"    ? store.add_airport(payload.get<Airport>())
+                    : op == "delete_airport" ? store.delete_airport(payload.at("code"))
+                    : store.update_airport(payload.at("code"), payload.at("changes"));
+            if (ok) publish_airports();
+            return ok;
+        }
+
+        if (op == "add_flight") {
+            size_t row = store.add_flight(payload.get<Flight>());
+            if (row == RecordStore::npos) return false;
+            patch_graph("", &store.flights[row]); return true;
+        }
+        if (op == "delete_flight") {
+            string id = payload.at("id");
+            if (store.delete_flight(id) == RecordStore::npos) return false;
+            patch_graph(id, nullptr); return true;
+        }
+        if (op == "update_flight") {
+            string old_id = payload.at("id");
+            size_t row = store.update_flight(old_id, payload.at("changes"));
+            if (row == RecordStore::npos) return false;
+            patch_graph(old_id, &store.flights[row]); return true;
+        }
+
+        if (op == "add_booking") return store.add_booking(payload.get<Booking>());
+        if (op == "cancel_booking") return store.cancel_booking(payload.at("booking_id"));
+        if (op == "add_user") return store.add_user(payload.get<User>());
+        if (op == "set_password") {
+            return store.set_password(payload.at("email"), payload.at("previous"), payload.at("password"));
+        }
+    } catch (const json::exception& e) {
+        cerr << "[WAL] Malformed " << op << " record: " << e.what() << endl;
+        return false;
+    }
+
+    cerr << "[WAL] Unknown operation: " << op << endl;
+    return false;
 }
 
 int JsonDB::parse_duration_string(const string& dur) {
@@ -56,240 +230,1053 @@ int JsonDB::parse_duration_string(const string& dur) {
 
 void JsonDB::build_graph() {
     // Note: We don't lock here because this is an internal helper called by locked functions
-    adj_list.clear();
-    
-    if (!data.contains("flights")) return;
+    vector<FlightLeg> legs;
+    legs.reserve(store.live_flights());
+    FlightLeg leg;
+    for (size_t i = 0; i < store.flights.size(); ++i) {
+        if (store.flight_live[i] && make_leg(store.flights[i], leg)) legs.push_back(leg);
+    }
+    auto next = make_shared<FlightGraph>();
+    next->build(legs);
+    atomic_store(&graph, shared_ptr<const FlightGraph>(move(next)));
+}
+
+// Parses the string fields of a flight once, so the graph only holds integers
+bool JsonDB::make_leg(const Flight& f, FlightLeg& leg) {
+    int day = FlightGraph::parse_schedule_date(f.date);
+    int dep = FlightGraph::parse_clock(f.departure);
+    int arr = FlightGraph::parse_clock(f.arrival);
+    if (day < 0 || dep < 0 || arr < 0) return false;
+
+    leg.from = f.from_code;
+    leg.to = f.to_code;
+    leg.flight_id = f.id;
+    leg.airline = f.airline;
+    leg.dep = day * 1440 + dep;
+    leg.arr = day * 1440 + arr;
+    if (leg.arr < leg.dep) leg.arr += 1440; // Lands after midnight
+    leg.weight_minutes = parse_duration_string(f.duration);
+    leg.price = f.price;
+    return true;
+}
+
+// Incremental graph maintenance: flight mutations patch only the edges
+// of the affected origin instead of rebuilding the whole graph. The patch
+// goes into a private copy which is then published, so in-flight searches
+// keep reading the snapshot they started with.
+void JsonDB::patch_graph(const string& remove_id, const Flight* add_flight) {
+    if (replaying) return;
+
+    auto next = make_shared<FlightGraph>(*graph);
+    int removed_dep = remove_id.empty() ? -1 : next->remove(remove_id);
+    FlightLeg leg;
+    bool added = add_flight && make_leg(*add_flight, leg);
+    if (added) next->insert(leg);
+    atomic_store(&graph, shared_ptr<const FlightGraph>(move(next)));
+
+    // Publish first, then invalidate: cached searches that read the
+    // touched days are dropped (see SearchCache for the fill race). The
+    // route table goes before the cache epoch moves: a search that sees
+    // the new epoch must not find the day's old table, or its stale body
+    // would be cached as current.
+    if (removed_dep >= 0) route_table.invalidate_day(removed_dep / 1440);
+    if (added) route_table.invalidate_day(leg.dep / 1440);
+    if (removed_dep >= 0) search_cache.invalidate_day(removed_dep / 1440);
+    if (added) search_cache.invalidate_day(leg.dep / 1440);
+}
 
-    for (const auto& f : data["flights"]) {
-        Edge e;
-        e.destination = f["to_code"];
-        e.flight_id = f["id"];
-        e.date = f["date"];
-        e.dep_time = f["departure"];
-        e.arr_time = f["arrival"];
-        e.price = f["price"];
-        e.airline = f["airline"];
-        e.weight_minutes = parse_duration_string(f["duration"]);
+json JsonDB::segment_json(const FlightGraph& g, int from, const Edge& e) {
+    const FlightInfo& info = g.flights[e.flight];
+    return {
+        {"airline", g.airlines[info.airline]},
+        {"flight_id", info.id},
+        {"from", g.airports[from]},
+        {"to", g.airports[e.destination]},
+        {"dep", FlightGraph::format_clock(e.dep)},
+        {"arr", FlightGraph::format_clock(e.arr)},
+        {"price", e.price},
+        {"date", FlightGraph::format_date(e.dep / 1440)}
+    };
+}
 
-        adj_list[f["from_code"]].push_back(e);
+// Common result shape of every route search
+json JsonDB::route_json(const FlightGraph& g, int from, const vector<const Edge*>& path, int total_minutes) {
+    json route;
+    route["total_time"] = total_minutes;
+    
+    int h = total_minutes / 60;
+    int m = total_minutes % 60;
+    route["duration_fmt"] = to_string(h) + "h " + to_string(m) + "m";
+    
+    route["stops"] = (int)path.size() - 1;
+    
+    json segments = json::array();
+    int current_from = from; 
+    int total_price = 0;
+
+    for(const Edge* e : path) {
+        segments.push_back(segment_json(g, current_from, *e));
+        current_from = e->destination;
+        total_price += e->price;
     }
+    
+    route["segments"] = segments;
+    route["total_price"] = total_price;
+    return route;
 }
 
 // ==========================================
 // THE K-SHORTEST PATH ALGORITHM
 // ==========================================
 
-struct PathState {
+// A search label: one partial path, stored as a parent pointer into the
+// per-query arena instead of a copied edge history.
+struct PathLabel {
     int total_minutes;
-    string current_node;
-    vector<Edge> history;
+    int node;
+    int parent;          // label index, -1 for the source
+    const Edge* edge;    // edge taken into 'node' (points into the graph snapshot)
+};
+
+// Scratch space reused by every search on this thread: after warm-up a
+// query performs no heap allocation until results are materialised.
+struct SearchArena {
+    vector<PathLabel> labels;
+    vector<uint64_t> visited;          // 'words' bitset words per label
+    vector<pair<int, int>> heap;       // (total_minutes, label index), min-heap
+    vector<int> visits;
+    vector<const Edge*> path;
+    size_t words = 0;
+
+    void reset(size_t num_airports) {
+        labels.clear();
+        visited.clear();
+        heap.clear();
+        visits.assign(num_airports, 0);
+        words = (num_airports + 63) / 64;
+    }
+
+    uint64_t* bits(int label) { return visited.data() + (size_t)label * words; }
+
+    // The new label's bitset starts as a copy of its parent's; the copy is
+    // taken after growing 'visited', which may move the parent's words
+    int push(const PathLabel& l) {
+        int idx = (int)labels.size();
+        labels.push_back(l);
+        visited.resize(visited.size() + words, 0);
+        if (l.parent >= 0) copy_n(bits(l.parent), words, bits(idx));
+        bits(idx)[l.node / 64] |= 1ULL << (l.node % 64);
 
-    bool operator>(const PathState& other) const {
-        return total_minutes > other.total_minutes;
+        heap.push_back({l.total_minutes, idx});
+        push_heap(heap.begin(), heap.end(), greater<pair<int, int>>());
+        return idx;
+    }
+
+    int pop() {
+        pop_heap(heap.begin(), heap.end(), greater<pair<int, int>>());
+        int idx = heap.back().second;
+        heap.pop_back();
+        return idx;
     }
 };
 
+static thread_local SearchArena search_arena;
+
+static bool departs_before(const Edge& e, int t) { return e.dep < t; }
+
+// One route found by a search, before it is turned into JSON
+struct RouteCandidate {
+    vector<const Edge*> path;
+    int total_minutes;
+    int price;
+};
+
+// k shortest loop-free routes s -> t leaving on 'day', in order of total
+// minutes (a 60-minute layover is charged per connection). Every route
+// has at least one edge: s == t yields nothing.
+static void k_shortest_routes(const FlightGraph& graph, int s, int t, int day, int k, vector<RouteCandidate>& results) {
+    if (s == t) return;
+    SearchArena& arena = search_arena;
+    arena.reset(graph.airports.size());
+    arena.push({0, s, -1, nullptr});
+
+    while (!arena.heap.empty() && (int)results.size() < k) {
+        int top = arena.pop();
+        const PathLabel label = arena.labels[top];
+
+        int u = label.node;
+
+        if (u == t) {
+            // Materialise only the paths that are actually returned
+            arena.path.clear();
+            for (int l = top; arena.labels[l].edge; l = arena.labels[l].parent) {
+                arena.path.push_back(arena.labels[l].edge);
+            }
+            reverse(arena.path.begin(), arena.path.end());
+
+            int price = 0;
+            for (const Edge* e : arena.path) price += e->price;
+            results.push_back({arena.path, label.total_minutes, price});
+            continue; 
+        }
+
+        if (arena.visits[u] >= k) continue;
+        arena.visits[u]++;
+
+        // Only the (u, day) slice is scanned; it is sorted by departure, so
+        // connections leaving before we land are skipped with one binary search
+        auto [first, last] = graph.slice(u, day);
+        if (label.edge) {
+            first = lower_bound(first, last, label.edge->arr, departs_before);
+        }
+
+        int layover = label.edge ? 60 : 0; 
+
+        for (const Edge* edge = first; edge != last; ++edge) {
+            // Cycle check: one bit per airport already on this path (incl. the source)
+            int v = edge->destination;
+            if (arena.bits(top)[v / 64] & (1ULL << (v % 64))) continue;
+
+            arena.push({label.total_minutes + edge->weight_minutes + layover, v, top, edge});
+        }
+    }
+}
+
 json JsonDB::find_smart_routes(const string& src, const string& dst, const string& req_date, int k) {
-    lock_guard<mutex> lock(db_mutex); // Now this will work because headers are correct
+    // No db_mutex: the search runs on an immutable graph snapshot
+    shared_ptr<const FlightGraph> snapshot = graph_snapshot();
+    const FlightGraph& graph = *snapshot;
     
     json results = json::array();
-    
-    priority_queue<PathState, vector<PathState>, greater<PathState>> pq;
-    pq.push({0, src, {}});
 
-    unordered_map<string, int> visits;
+    int s = graph.find_airport(src);
+    int t = graph.find_airport(dst);
+    int day = FlightGraph::parse_schedule_date(req_date);
+    if (s < 0 || t < 0 || day < 0) return results;
+
+    // Most queries are a direct flight or a one-stop: answered by lookup
+    vector<const TableRoute*> hits;
+    if (auto table = route_table.lookup(graph, s, t, day, k, hits)) {
+        vector<const Edge*> path;
+        for (const TableRoute* r : hits) {
+            path.assign(1, &table->legs[r->first]);
+            if (r->second != TableRoute::NO_LEG) path.push_back(&table->legs[r->second]);
+            results.push_back(route_json(graph, s, path, r->total_minutes));
+        }
+        return results;
+    }
 
-    while (!pq.empty() && results.size() < k) {
-        PathState top = pq.top();
-        pq.pop();
+    vector<RouteCandidate> routes;
+    k_shortest_routes(graph, s, t, day, k, routes);
+    for (const auto& r : routes) results.push_back(route_json(graph, s, r.path, r.total_minutes));
+    return results;
+}
 
-        string u = top.current_node;
+// ==========================================
+// ROUND TRIP
+// ==========================================
 
-        if (u == dst) {
-            json route;
-            route["total_time"] = top.total_minutes;
-            
-            int h = top.total_minutes / 60;
-            int m = top.total_minutes % 60;
-            route["duration_fmt"] = to_string(h) + "h " + to_string(m) + "m";
-            
-            route["stops"] = (int)top.history.size() - 1;
-            
-            json segments = json::array();
-            string current_from = src; 
-
-            for(const auto& h : top.history) {
-                segments.push_back({
-                    {"airline", h.airline},
-                    {"flight_id", h.flight_id},
-                    {"from", current_from}, 
-                    {"to", h.destination},
-                    {"dep", h.dep_time},
-                    {"arr", h.arr_time},
-                    {"price", h.price},
-                    {"date", h.date}
-                });
-                current_from = h.destination;
-            }
-            
-            route["segments"] = segments;
-            
-            int total_price = 0;
-            for(const auto& s : segments) total_price += (int)s["price"];
-            route["total_price"] = total_price;
+json JsonDB::find_roundtrip_routes(const string& src, const string& dst, const string& out_date,
+                                   const string& ret_date, int k) {
+    // Both legs read the same snapshot, so they see one consistent timetable
+    shared_ptr<const FlightGraph> snapshot = graph_snapshot();
+    const FlightGraph& graph = *snapshot;
 
-            results.push_back(route);
-            continue; 
+    json results = json::array();
+
+    int s = graph.find_airport(src);
+    int t = graph.find_airport(dst);
+    int out_day = FlightGraph::parse_schedule_date(out_date);
+    int ret_day = FlightGraph::parse_schedule_date(ret_date);
+    if (s < 0 || t < 0 || s == t || out_day < 0 || ret_day < out_day) return results;
+
+    // Outbound on a worker (it has its own thread_local arena), return leg
+    // here; a saturated pool just means running both on this thread
+    vector<RouteCandidate> outbound, inbound;
+    auto outbound_done = search_pool.submit([&] { k_shortest_routes(graph, s, t, out_day, k, outbound); });
+    if (!outbound_done.valid()) k_shortest_routes(graph, s, t, out_day, k, outbound);
+    k_shortest_routes(graph, t, s, ret_day, k, inbound);
+    if (outbound_done.valid()) outbound_done.get();
+
+    // Feasible pairs (the return must leave after the outbound lands),
+    // reduced to the Pareto front of (total price, total minutes)
+    struct Pair { int price; int minutes; int out; int ret; };
+    vector<Pair> pairs;
+    for (size_t o = 0; o < outbound.size(); ++o) {
+        for (size_t r = 0; r < inbound.size(); ++r) {
+            if (inbound[r].path.front()->dep < outbound[o].path.back()->arr) continue;
+            pairs.push_back({outbound[o].price + inbound[r].price,
+                             outbound[o].total_minutes + inbound[r].total_minutes, (int)o, (int)r});
         }
+    }
+    sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) {
+        return a.price != b.price ? a.price < b.price : a.minutes < b.minutes;
+    });
+
+    int best_minutes = INT_MAX;
+    for (const Pair& p : pairs) {
+        // Sorted by price: a pair survives only if it is faster than every cheaper one
+        if (p.minutes >= best_minutes) continue;
+        best_minutes = p.minutes;
+
+        json itinerary;
+        itinerary["total_price"] = p.price;
+        itinerary["total_time"] = p.minutes;
+        itinerary["duration_fmt"] = to_string(p.minutes / 60) + "h " + to_string(p.minutes % 60) + "m";
+        itinerary["outbound"] = route_json(graph, s, outbound[p.out].path, outbound[p.out].total_minutes);
+        itinerary["return"] = route_json(graph, t, inbound[p.ret].path, inbound[p.ret].total_minutes);
+        results.push_back(move(itinerary));
+        if ((int)results.size() >= k) break;
+    }
+    return results;
+}
 
-        if (visits[u] >= k) continue;
-        visits[u]++;
+// ==========================================
+// CONNECTION SCAN (EARLIEST ARRIVAL)
+// ==========================================
 
-        if (adj_list.find(u) != adj_list.end()) {
-            for (const auto& edge : adj_list[u]) {
-                
-                if (edge.date != req_date) continue;
+// Earliest arrival at every airport from 's', leaving from 00:00 of 'day'
+// and departing before the CSA horizon. Stops once 't' can no longer
+// improve; t = -1 scans the whole horizon (one-to-all).
+static void connection_scan(const FlightGraph& graph, int s, int day, int t, int min_connection,
+                            vector<int>& earliest, vector<const Connection*>& parent) {
+    const int INF = INT_MAX;
+    const int start = day * 1440;
+    const int horizon = start + CSA_HORIZON_MINUTES;
+
+    earliest.assign(graph.airports.size(), INF);
+    parent.assign(graph.airports.size(), nullptr);
+    earliest[s] = start;
+
+    // One sweep over the departure-sorted timetable, starting at 00:00 of the date
+    auto first = lower_bound(graph.connections.begin(), graph.connections.end(), start,
+                             [](const Connection& c, int time) { return c.edge.dep < time; });
+
+    for (auto c = first; c != graph.connections.end(); ++c) {
+        const Edge& e = c->edge;
+        // Nothing departing after we have landed (or past the horizon) can improve
+        if ((t >= 0 && e.dep >= earliest[t]) || e.dep >= horizon) break;
+
+        if (earliest[c->origin] == INF) continue;
+        int ready = c->origin == s ? earliest[s] : earliest[c->origin] + min_connection;
+        if (e.dep < ready || e.arr >= earliest[e.destination]) continue;
+
+        earliest[e.destination] = e.arr;
+        parent[e.destination] = &*c;
+    }
+}
 
-                bool cycle = false;
-                for(const auto& prev : top.history) {
-                     if (edge.destination == src || prev.destination == edge.destination) cycle = true;
-                }
-                if (cycle) continue;
+// Negative connection times would let a leg depart before the previous one
+// lands; huge ones overflow 'arr + min_connection'
+static int clamp_connection(int minutes) { return max(0, min(minutes, MAX_CONNECTION_MINUTES)); }
 
-                if (!top.history.empty()) {
-                    string prev_arr = top.history.back().arr_time;
-                    if (edge.dep_time < prev_arr) continue; 
-                }
+json JsonDB::find_earliest_arrival(const string& src, const string& dst, const string& req_date, int min_connection) {
+    // No db_mutex: the search runs on an immutable graph snapshot
+    shared_ptr<const FlightGraph> snapshot = graph_snapshot();
+    const FlightGraph& graph = *snapshot;
 
-                vector<Edge> new_history = top.history;
-                new_history.push_back(edge);
-                
-                int layover = top.history.empty() ? 0 : 60; 
+    json results = json::array();
+
+    int s = graph.find_airport(src);
+    int t = graph.find_airport(dst);
+    int day = FlightGraph::parse_schedule_date(req_date);
+    if (s < 0 || t < 0 || day < 0 || s == t) return results;
+    min_connection = clamp_connection(min_connection);
+
+    const int INF = INT_MAX;
+    vector<int> earliest;
+    vector<const Connection*> parent;
+    connection_scan(graph, s, day, t, min_connection, earliest, parent);
+
+    if (earliest[t] == INF) return results;
+
+    vector<const Edge*> path;
+    for (int v = t; v != s; v = parent[v]->origin) path.push_back(&parent[v]->edge);
+    reverse(path.begin(), path.end());
+
+    // total_time here is elapsed wall-clock time from first departure
+    json route = route_json(graph, s, path, earliest[t] - path.front()->dep);
+    route["departure"] = FlightGraph::format_date(path.front()->dep / 1440) + " " + FlightGraph::format_clock(path.front()->dep);
+    route["arrival"] = FlightGraph::format_date(earliest[t] / 1440) + " " + FlightGraph::format_clock(earliest[t]);
+    route["min_connection"] = min_connection;
+    results.push_back(route);
+    return results;
+}
+
+// ==========================================
+// MULTI-CRITERIA (PARETO) SEARCH
+// ==========================================
+// McRAPTOR-style rounds: round r extends the labels created in round r-1
+// by one leg. A label survives only if no other label at the same airport
+// is at least as good on every criterion (later first departure, earlier
+// arrival, lower price, fewer legs), which also rules out cycles.
+
+struct ParetoLabel {
+    int first_dep;
+    int arr;
+    int price;
+    int legs;
+    int node;
+    int parent;          // label index, -1 for the first leg
+    const Edge* edge;
+    bool dead;           // dominated after insertion
+};
+
+struct ParetoArena {
+    vector<ParetoLabel> labels;
+    vector<vector<int>> bags;          // live label indexes per airport
+    vector<int> frontier, next_frontier;
+    vector<const Edge*> path;
+
+    void reset(size_t num_airports) {
+        labels.clear();
+        if (bags.size() < num_airports) bags.resize(num_airports);
+        for (auto& b : bags) b.clear();
+        frontier.clear();
+        next_frontier.clear();
+    }
+};
+
+static thread_local ParetoArena pareto_arena;
+
+static bool pareto_dominates(const ParetoLabel& a, const ParetoLabel& b) {
+    return a.first_dep >= b.first_dep && a.arr <= b.arr && a.price <= b.price && a.legs <= b.legs;
+}
+
+json JsonDB::find_pareto_routes(const string& src, const string& dst, const string& req_date,
+                                int max_stops, int min_connection) {
+    // No db_mutex: the search runs on an immutable graph snapshot
+    shared_ptr<const FlightGraph> snapshot = graph_snapshot();
+    const FlightGraph& graph = *snapshot;
 
-                pq.push({
-                    top.total_minutes + edge.weight_minutes + layover, 
-                    edge.destination, 
-                    new_history
-                });
+    json results = json::array();
+
+    int s = graph.find_airport(src);
+    int t = graph.find_airport(dst);
+    int day = FlightGraph::parse_schedule_date(req_date);
+    if (s < 0 || t < 0 || day < 0 || s == t) return results;
+    max_stops = max(0, min(max_stops, PARETO_MAX_STOPS));
+    min_connection = clamp_connection(min_connection);
+
+    const int horizon = day * 1440 + CSA_HORIZON_MINUTES;
+    ParetoArena& arena = pareto_arena;
+    arena.reset(graph.airports.size());
+
+    // Adds a label unless dominated; kills the labels it dominates
+    auto offer = [&](const ParetoLabel& l) {
+        if (l.node == s) return;
+        // Target pruning: a finished itinerary that is already at least as
+        // good can only get better than this partial one
+        for (int i : arena.bags[t]) {
+            const ParetoLabel& d = arena.labels[i];
+            if (d.price <= l.price && d.legs <= l.legs && d.arr - d.first_dep <= l.arr - l.first_dep) return;
+        }
+        auto& bag = arena.bags[l.node];
+        for (int i : bag) if (pareto_dominates(arena.labels[i], l)) return;
+
+        size_t keep = 0;
+        for (int i : bag) {
+            if (pareto_dominates(l, arena.labels[i])) arena.labels[i].dead = true;
+            else bag[keep++] = i;
+        }
+        bag.resize(keep);
+
+        int idx = (int)arena.labels.size();
+        arena.labels.push_back(l);
+        bag.push_back(idx);
+        if (l.node != t) arena.next_frontier.push_back(idx);
+    };
+
+    // Round 1: every flight leaving the source on the requested date
+    auto [first, last] = graph.slice(s, day);
+    for (const Edge* e = first; e != last; ++e) {
+        offer({e->dep, e->arr, e->price, 1, e->destination, -1, e, false});
+    }
+
+    for (int round = 2; round <= max_stops + 1 && !arena.next_frontier.empty(); ++round) {
+        arena.frontier.swap(arena.next_frontier);
+        arena.next_frontier.clear();
+
+        for (int li : arena.frontier) {
+            const ParetoLabel l = arena.labels[li];
+            if (l.dead) continue;
+
+            // Later legs may continue past midnight, up to the horizon
+            int ready = l.arr + min_connection;
+            for (int d = ready / 1440; d * 1440 < horizon; ++d) {
+                auto [f, e_end] = graph.slice(l.node, d);
+                f = lower_bound(f, e_end, ready, departs_before);
+                for (const Edge* e = f; e != e_end && e->dep < horizon; ++e) {
+                    offer({l.first_dep, e->arr, l.price + e->price, l.legs + 1, e->destination, li, e, false});
+                }
             }
         }
     }
 
+    // The destination bag is the Pareto front of (duration, price, stops)
+    vector<int> front(arena.bags[t].begin(), arena.bags[t].end());
+    sort(front.begin(), front.end(), [&](int a, int b) {
+        const ParetoLabel& x = arena.labels[a];
+        const ParetoLabel& y = arena.labels[b];
+        int dx = x.arr - x.first_dep, dy = y.arr - y.first_dep;
+        if (dx != dy) return dx < dy;
+        if (x.price != y.price) return x.price < y.price;
+        return x.legs < y.legs;
+    });
+
+    int best_price = INT_MAX, best_time = INT_MAX;
+    for (int i : front) {
+        const ParetoLabel& l = arena.labels[i];
+        // Labels with a different first departure can tie on all three
+        // visible criteria; keep only strictly Pareto-optimal ones
+        bool dominated = false;
+        for (int j : front) {
+            const ParetoLabel& o = arena.labels[j];
+            if (j == i) continue;
+            bool no_worse = o.arr - o.first_dep <= l.arr - l.first_dep && o.price <= l.price && o.legs <= l.legs;
+            bool better = o.arr - o.first_dep < l.arr - l.first_dep || o.price < l.price || o.legs < l.legs;
+            if (no_worse && (better || j < i)) { dominated = true; break; }
+        }
+        if (dominated) continue;
+
+        arena.path.clear();
+        for (int p = i; p != -1; p = arena.labels[p].parent) arena.path.push_back(arena.labels[p].edge);
+        reverse(arena.path.begin(), arena.path.end());
+
+        json route = route_json(graph, s, arena.path, l.arr - l.first_dep);
+        best_price = min(best_price, l.price);
+        best_time = min(best_time, l.arr - l.first_dep);
+        results.push_back(route);
+    }
+
+    // Tag the extremes so a comparison view needs no second request
+    for (auto& r : results) {
+        r["cheapest"] = r["total_price"] == best_price;
+        r["fastest"] = r["total_time"] == best_time;
+    }
     return results;
 }
 
 // ==========================================
-// BELLMAN-FORD IMPLEMENTATION
+// CHEAPEST FARE (TIME-DEPENDENT DIJKSTRA)
 // ==========================================
+// Prices are non-negative, so Dijkstra applies. A label is "having taken
+// flight e": it is popped in price order and only expands if it lands at
+// its airport earlier than every cheaper label already expanded there
+// (a later, pricier arrival can only reach a subset of the same flights).
+// Each expansion scans just the departures that the previous, later
+// arrival could not make, so every bucket is walked about once.
+
+struct FareLabel {
+    int price;
+    const Edge* edge;
+    int parent;          // label index, -1 for the first leg
+};
 
-json JsonDB::find_bellman_route(const string& src, const string& dst, const string& req_date) {
-    lock_guard<mutex> lock(db_mutex);
+struct FareArena {
+    vector<FareLabel> labels;
+    vector<pair<int, int>> heap;       // (price, label index), min-heap
+    vector<int> settled_arr;           // earliest arrival expanded per airport
+    vector<int> best;                  // cheapest label per airport, -1 if unreached
+    vector<const Edge*> path;
+
+    void reset(size_t num_airports) {
+        labels.clear();
+        heap.clear();
+        settled_arr.assign(num_airports, INT_MAX);
+        best.assign(num_airports, -1);
+    }
 
-    // 1. Identify all unique airports (Nodes)
-    // We need to map string codes to 0..V-1 or just use map<string, long long>
-    // Using map is easier but slightly slower. Given V=50, it's fine.
-    
-    // Initialize Distances to Infinity
-    map<string, long long> dist;
-    map<string, string> parent_airport;
-    map<string, Edge> parent_edge; // To store flight details
-
-    // Initialize all known airports (from adj_list and their destinations)
-    // Best way: iterate data["airports"]
-    if (data.contains("airports")) {
-        for (const auto& a : data["airports"]) {
-            dist[a["code"]] = -1; // -1 represents Infinity
-        }
+    void push(const FareLabel& l) {
+        heap.push_back({l.price, (int)labels.size()});
+        labels.push_back(l);
+        push_heap(heap.begin(), heap.end(), greater<pair<int, int>>());
     }
-    // Also ensure src/dst are there
-    dist[src] = 0;
+};
 
-    // 2. Relax Edges (V-1 times)
-    // V = number of airports
-    int V = dist.size(); 
-    if (V == 0) return json::object(); // Should not happen if seeded
+static thread_local FareArena fare_arena;
 
-    // Get all relevant flights (Edges) for the date once
-    vector<pair<string, Edge>> all_edges; // pair<From, Edge>
-    for (const auto& [u_code, edges] : adj_list) {
-        for (const auto& e : edges) {
-            if (e.date == req_date) { // Only flights on this date
-                all_edges.push_back({u_code, e});
-            }
+// Cheapest fares from 's' with every leg departing on 'day'. Stops as soon
+// as 't' is settled; pass t = -1 to settle every reachable airport.
+static void cheapest_fares(const FlightGraph& g, int s, int day, int t, int min_connection, FareArena& a) {
+    a.reset(g.airports.size());
+
+    auto [first, last] = g.slice(s, day);
+    for (const Edge* e = first; e != last; ++e) {
+        if (e->destination != s) a.push({e->price, e, -1});
+    }
+
+    while (!a.heap.empty()) {
+        pop_heap(a.heap.begin(), a.heap.end(), greater<pair<int, int>>());
+        int li = a.heap.back().second;
+        a.heap.pop_back();
+
+        const FareLabel l = a.labels[li];
+        int v = l.edge->destination;
+        if (l.edge->arr >= a.settled_arr[v]) continue; // dominated
+
+        int previous_ready = a.settled_arr[v] == INT_MAX ? INT_MAX : a.settled_arr[v] + min_connection;
+        a.settled_arr[v] = l.edge->arr;
+        if (a.best[v] == -1) a.best[v] = li;
+        if (v == t) return;
+
+        auto [f, e_end] = g.slice(v, day);
+        const Edge* from = lower_bound(f, e_end, l.edge->arr + min_connection, departs_before);
+        const Edge* to = previous_ready == INT_MAX ? e_end : lower_bound(f, e_end, previous_ready, departs_before);
+        for (const Edge* e = from; e < to; ++e) {
+            int w = e->destination;
+            if (w == s || e->arr >= a.settled_arr[w]) continue;
+            a.push({l.price + e->price, e, li});
         }
     }
+}
 
-    for (int i = 0; i < V - 1; ++i) {
-        bool changed = false;
-        
-        for (const auto& item : all_edges) {
-            string u = item.first;
-            const Edge& e = item.second;
-            string v = e.destination;
-
-            // If dist[u] is not infinity
-            if (dist.find(u) != dist.end() && dist[u] != -1) {
-                // Relaxation check: dist[u] + cost < dist[v]
-                // Note: dist[v] == -1 means infinity
-                if (dist.find(v) != dist.end()) {
-                    if (dist[v] == -1 || dist[u] + e.price < dist[v]) {
-                        dist[v] = dist[u] + e.price;
-                        parent_airport[v] = u;
-                        parent_edge[v] = e;
-                        changed = true;
-                    }
-                }
+// ==========================================
+// FARE CALENDAR
+// ==========================================
+// One cheapest-fare search per day of the window. Every day reads only
+// its own date-partitioned slices, so the days are independent and are
+// spread over the search pool in contiguous chunks.
+
+json JsonDB::find_fare_calendar(const string& src, const string& dst, const string& start_date, int num_days,
+                                int min_connection, bool with_durations) {
+    shared_ptr<const FlightGraph> snapshot = graph_snapshot();
+    const FlightGraph& graph = *snapshot;
+
+    json calendar;
+    calendar["from"] = src;
+    calendar["to"] = dst;
+    calendar["days"] = json::array();
+
+    int s = graph.find_airport(src);
+    int t = graph.find_airport(dst);
+    int first_day = FlightGraph::parse_schedule_date(start_date);
+    if (s < 0 || t < 0 || first_day < 0 || s == t || num_days <= 0) return calendar;
+    min_connection = clamp_connection(min_connection);
+
+    struct DayFare {
+        int price = -1;          // -1: no route that day
+        int stops = 0;
+        int dep = 0;
+        int elapsed = 0;         // first departure to last arrival
+        int fastest = -1;        // smart-search total minutes, if requested
+    };
+    vector<DayFare> fares(num_days);
+
+    auto solve = [&](int begin, int end) {
+        FareArena& arena = fare_arena;
+        vector<RouteCandidate> fastest;
+        for (int i = begin; i < end; ++i) {
+            int day = first_day + i;
+            cheapest_fares(graph, s, day, t, min_connection, arena);
+            if (arena.best[t] != -1) {
+                DayFare& f = fares[i];
+                const FareLabel& last = arena.labels[arena.best[t]];
+                int l = arena.best[t];
+                while (arena.labels[l].parent != -1) { l = arena.labels[l].parent; f.stops++; }
+                f.price = last.price;
+                f.dep = arena.labels[l].edge->dep;
+                f.elapsed = last.edge->arr - f.dep;
+            }
+            if (with_durations) {
+                fastest.clear();
+                k_shortest_routes(graph, s, t, day, 1, fastest);
+                if (!fastest.empty()) fares[i].fastest = fastest[0].total_minutes;
             }
         }
-        if (!changed) break; // Optimization
+    };
+
+    // Chunk 0 runs here; the rest go to helpers while slots are free
+    int chunks = (int)min<size_t>(search_pool.size() + 1, (size_t)num_days);
+    int per_chunk = (num_days + chunks - 1) / chunks;
+    vector<future<void>> pending;
+    for (int c = 1; c < chunks; ++c) {
+        int begin = c * per_chunk, end = min(num_days, begin + per_chunk);
+        if (begin >= end) break;
+        auto done = search_pool.submit([&solve, begin, end] { solve(begin, end); });
+        if (done.valid()) pending.push_back(move(done));
+        else solve(begin, end);
+    }
+    solve(0, min(num_days, per_chunk));
+    for (auto& p : pending) p.get();
+
+    int best = -1;
+    for (int i = 0; i < num_days; ++i) {
+        const DayFare& f = fares[i];
+        json entry;
+        entry["date"] = FlightGraph::format_date(first_day + i);
+        if (f.price < 0) {
+            entry["price"] = nullptr;
+        } else {
+            entry["price"] = f.price;
+            entry["stops"] = f.stops;
+            entry["departure"] = FlightGraph::format_clock(f.dep);
+            entry["duration_fmt"] = to_string(f.elapsed / 60) + "h " + to_string(f.elapsed % 60) + "m";
+            if (best < 0 || f.price < fares[best].price) best = i;
+        }
+        if (with_durations) {
+            if (f.fastest < 0) entry["fastest_time"] = nullptr;
+            else entry["fastest_time"] = f.fastest;
+        }
+        calendar["days"].push_back(move(entry));
+    }
+    calendar["cheapest_date"] = best < 0 ? json(nullptr) : json(FlightGraph::format_date(first_day + best));
+    calendar["cheapest_price"] = best < 0 ? json(nullptr) : json(fares[best].price);
+    return calendar;
+}
+
+// ==========================================
+// EXPLORE (ONE-TO-ALL)
+// ==========================================
+// The single-source searches already compute every airport on the way;
+// here both are simply run without a target and the whole tree is kept.
+
+// Airports and flight ids along a path that starts at 's'
+static json path_json(const FlightGraph& g, int s, const vector<const Edge*>& path) {
+    json airports = json::array({g.airports[s]});
+    json flights = json::array();
+    for (const Edge* e : path) {
+        airports.push_back(g.airports[e->destination]);
+        flights.push_back(g.flights[e->flight].id);
+    }
+    return {{"via", move(airports)}, {"flight_ids", move(flights)}};
+}
+
+static string format_time(int minutes) {
+    return FlightGraph::format_date(minutes / 1440) + " " + FlightGraph::format_clock(minutes);
+}
+
+json JsonDB::find_explore_map(const string& src, const string& req_date, int min_connection) {
+    shared_ptr<const FlightGraph> snapshot = graph_snapshot();
+    const FlightGraph& graph = *snapshot;
+
+    json result;
+    result["origin"] = src;
+    result["date"] = req_date;
+    result["destinations"] = json::array();
+
+    int s = graph.find_airport(src);
+    int day = FlightGraph::parse_schedule_date(req_date);
+    if (s < 0 || day < 0) return result;
+    min_connection = clamp_connection(min_connection);
+
+    // Cheapest: same-day fares, Dijkstra run until the heap is empty
+    FareArena& arena = fare_arena;
+    cheapest_fares(graph, s, day, -1, min_connection, arena);
+
+    // Fastest: earliest arrival, one scan over the horizon
+    vector<int> earliest;
+    vector<const Connection*> parent;
+    connection_scan(graph, s, day, -1, min_connection, earliest, parent);
+
+    vector<int> order;
+    for (int v = 0; v < (int)graph.airports.size(); ++v) {
+        if (v != s && (arena.best[v] != -1 || parent[v])) order.push_back(v);
+    }
+    sort(order.begin(), order.end(), [&](int a, int b) { return graph.airports[a] < graph.airports[b]; });
+
+    vector<const Edge*> path;
+    for (int v : order) {
+        json entry;
+        entry["code"] = graph.airports[v];
+
+        if (arena.best[v] == -1) {
+            entry["cheapest"] = nullptr;
+        } else {
+            path.clear();
+            for (int l = arena.best[v]; l != -1; l = arena.labels[l].parent) path.push_back(arena.labels[l].edge);
+            reverse(path.begin(), path.end());
+            json cheapest = path_json(graph, s, path);
+            cheapest["price"] = arena.labels[arena.best[v]].price;
+            cheapest["stops"] = (int)path.size() - 1;
+            cheapest["departure"] = format_time(path.front()->dep);
+            cheapest["arrival"] = format_time(path.back()->arr);
+            entry["cheapest"] = move(cheapest);
+        }
+
+        if (!parent[v]) {
+            entry["fastest"] = nullptr;
+        } else {
+            path.clear();
+            for (int u = v; u != s; u = parent[u]->origin) path.push_back(&parent[u]->edge);
+            reverse(path.begin(), path.end());
+            json fastest = path_json(graph, s, path);
+            int price = 0;
+            for (const Edge* e : path) price += e->price;
+            fastest["price"] = price;
+            fastest["stops"] = (int)path.size() - 1;
+            fastest["departure"] = format_time(path.front()->dep);
+            fastest["arrival"] = format_time(earliest[v]);
+            fastest["total_time"] = earliest[v] - path.front()->dep;
+            entry["fastest"] = move(fastest);
+        }
+        result["destinations"].push_back(move(entry));
     }
+    return result;
+}
+
+json JsonDB::find_cheapest_route(const string& src, const string& dst, const string& req_date, int min_connection) {
+    // No db_mutex: the search runs on an immutable graph snapshot
+    shared_ptr<const FlightGraph> snapshot = graph_snapshot();
+    const FlightGraph& graph = *snapshot;
 
-    // 3. Construct Result
     json result;
-    if (dist.find(dst) == dist.end() || dist[dst] == -1) {
+    int s = graph.find_airport(src);
+    int t = graph.find_airport(dst);
+    int day = FlightGraph::parse_schedule_date(req_date);
+    if (s < 0 || t < 0 || day < 0 || s == t) {
         result["error"] = "No path found";
         return result;
     }
 
-    result["total_price"] = dist[dst];
-    result["algorithm"] = "Bellman-Ford";
-    
-    // Reconstruct Path
-    vector<json> segments;
-    string curr = dst;
-    while (curr != src) {
-        // If we get stuck (shouldn't happen if path exists), break
-        if (parent_airport.find(curr) == parent_airport.end()) break;
-        
-        string prev = parent_airport[curr];
-        Edge e = parent_edge[curr];
-        
-        segments.push_back({
-            {"airline", e.airline},
-            {"flight_id", e.flight_id},
-            {"from", prev},
-            {"to", curr},
-            {"dep", e.dep_time},
-            {"arr", e.arr_time},
-            {"price", e.price},
-            {"date", e.date}
-        });
-
-        curr = prev;
+    min_connection = clamp_connection(min_connection);
+    FareArena& arena = fare_arena;
+    cheapest_fares(graph, s, day, t, min_connection, arena);
+    if (arena.best[t] == -1) {
+        result["error"] = "No path found";
+        return result;
     }
-    
-    // Reverse segments to be Source -> Dest
-    std::reverse(segments.begin(), segments.end());
-    result["segments"] = segments;
-    result["stops"] = (int)segments.size() - 1;
 
-    // Calculate approx duration (incorrect for Bellman Ford without time logic, but shown for compat)
-    result["duration_fmt"] = "N/A (Cost Optimized)";
+    arena.path.clear();
+    for (int l = arena.best[t]; l != -1; l = arena.labels[l].parent) arena.path.push_back(arena.labels[l].edge);
+    reverse(arena.path.begin(), arena.path.end());
 
+    result = route_json(graph, s, arena.path, arena.path.back()->arr - arena.path.front()->dep);
+    result["algorithm"] = "Dijkstra (cheapest fare)";
+    result["min_connection"] = min_connection;
     return result;
 }
 
 
+// ==========================================
+// CACHED SEARCH DISPATCH
+// ==========================================
+
+string JsonDB::search_json(const SearchQuery& query) {
+    SearchQuery q = query;
+    if (q.mode != "earliest" && q.mode != "pareto" && q.mode != "cheapest") q.mode = "smart";
+
+    // The key holds only what the mode reads, after the clamping the
+    // engine applies, so equal answers share one entry
+    q.min_connection = clamp_connection(q.min_connection);
+    q.max_stops = max(0, min(q.max_stops, PARETO_MAX_STOPS));
+    string key = q.mode + '|' + q.from + '|' + q.to + '|' + q.date + '|';
+    if (q.mode == "smart") key += to_string(q.k);
+    else if (q.mode == "pareto") key += to_string(q.max_stops) + '|' + to_string(q.min_connection);
+    else key += to_string(q.min_connection);
+
+    string body;
+    if (search_cache.get(key, body)) return body;
+
+    // Taken before the search loads its graph snapshot
+    uint64_t epoch = search_cache.epoch();
+
+    // Days of departures each mode may read
+    int day = FlightGraph::parse_schedule_date(q.date);
+    int last_day = day;
+    json result;
+    if (q.mode == "earliest") {
+        result = find_earliest_arrival(q.from, q.to, q.date, q.min_connection);
+        last_day = day + (CSA_HORIZON_MINUTES - 1) / 1440;
+    } else if (q.mode == "pareto") {
+        result = find_pareto_routes(q.from, q.to, q.date, q.max_stops, q.min_connection);
+        last_day = day + (CSA_HORIZON_MINUTES - 1) / 1440;
+    } else if (q.mode == "cheapest") {
+        result = find_cheapest_route(q.from, q.to, q.date, q.min_connection);
+    } else {
+        result = find_smart_routes(q.from, q.to, q.date, q.k);
+    }
+
+    body = result.dump();
+    if (day >= 0) search_cache.put(key, day, last_day, epoch, body);
+    return body;
+}
+
+json JsonDB::find_multicity_routes(const vector<SearchQuery>& legs, int k, int min_connection, bool by_time) {
+    shared_ptr<const FlightGraph> snapshot = graph_snapshot();
+    const FlightGraph& graph = *snapshot;
+
+    json results = json::array();
+    size_t n = legs.size();
+    if (n == 0) return results;
+    min_connection = clamp_connection(min_connection);
+
+    vector<int> from(n), to(n), day(n);
+    for (size_t i = 0; i < n; ++i) {
+        from[i] = graph.find_airport(legs[i].from);
+        to[i] = graph.find_airport(legs[i].to);
+        day[i] = FlightGraph::parse_schedule_date(legs[i].date);
+        if (from[i] < 0 || to[i] < 0 || from[i] == to[i] || day[i] < 0) return results;
+    }
+
+    // Every leg is independent: legs 1..n-1 go to helpers, leg 0 runs
+    // here, so the wait is roughly the slowest leg rather than the sum
+    vector<vector<RouteCandidate>> options(n);
+    auto search_leg = [&](size_t i) {
+        k_shortest_routes(graph, from[i], to[i], day[i], k, options[i]);
+        auto cost = [&](const RouteCandidate& r) {
+            return by_time ? make_pair(r.total_minutes, r.price) : make_pair(r.price, r.total_minutes);
+        };
+        stable_sort(options[i].begin(), options[i].end(),
+                    [&](const RouteCandidate& a, const RouteCandidate& b) { return cost(a) < cost(b); });
+    };
+    vector<future<void>> pending(n);
+    for (size_t i = 1; i < n; ++i) {
+        pending[i] = search_pool.submit([&search_leg, i] { search_leg(i); });
+        if (!pending[i].valid()) search_leg(i);
+    }
+    search_leg(0);
+    for (size_t i = 1; i < n; ++i) {
+        if (pending[i].valid()) pending[i].get();
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (options[i].empty()) return results;
+    }
+
+    // Best-first merge over index tuples (one chosen option per leg). Each
+    // tuple is generated once: successors only advance positions at or
+    // after the last one advanced. Infeasible tuples are still expanded,
+    // since a later option of the same leg may connect.
+    struct Combo { int cost; int tie; vector<int> pick; size_t last; };
+    auto totals = [&](const vector<int>& pick, int& price, int& minutes) {
+        price = minutes = 0;
+        for (size_t i = 0; i < n; ++i) {
+            price += options[i][pick[i]].price;
+            minutes += options[i][pick[i]].total_minutes;
+        }
+    };
+    auto make_combo = [&](vector<int> pick, size_t last) {
+        int price, minutes;
+        totals(pick, price, minutes);
+        return by_time ? Combo{minutes, price, move(pick), last} : Combo{price, minutes, move(pick), last};
+    };
+    auto worse = [](const Combo& a, const Combo& b) { return a.cost != b.cost ? a.cost > b.cost : a.tie > b.tie; };
+
+    priority_queue<Combo, vector<Combo>, decltype(worse)> frontier(worse);
+    frontier.push(make_combo(vector<int>(n, 0), 0));
+
+    size_t expansions = 0;
+    while (!frontier.empty() && (int)results.size() < k && expansions++ < MULTICITY_MAX_EXPANSIONS) {
+        Combo c = frontier.top();
+        frontier.pop();
+
+        bool feasible = true;
+        for (size_t i = 0; i + 1 < n && feasible; ++i) {
+            const Edge* landed = options[i][c.pick[i]].path.back();
+            const Edge* next = options[i + 1][c.pick[i + 1]].path.front();
+            feasible = next->dep >= landed->arr + min_connection;
+        }
+        if (feasible) {
+            int price, minutes;
+            totals(c.pick, price, minutes);
+            json itinerary;
+            itinerary["total_price"] = price;
+            itinerary["total_time"] = minutes;
+            itinerary["duration_fmt"] = to_string(minutes / 60) + "h " + to_string(minutes % 60) + "m";
+            json leg_routes = json::array();
+            for (size_t i = 0; i < n; ++i) {
+                const RouteCandidate& r = options[i][c.pick[i]];
+                leg_routes.push_back(route_json(graph, from[i], r.path, r.total_minutes));
+            }
+            itinerary["legs"] = move(leg_routes);
+            results.push_back(move(itinerary));
+        }
+
+        for (size_t i = c.last; i < n; ++i) {
+            if (c.pick[i] + 1 >= (int)options[i].size()) continue;
+            vector<int> next = c.pick;
+            next[i]++;
+            frontier.push(make_combo(move(next), i));
+        }
+    }
+    return results;
+}
+
+string JsonDB::calendar_json(const string& from, const string& to, const string& start_date, int num_days,
+                             int min_connection, bool with_durations) {
+    string key = "calendar|" + from + '|' + to + '|' + start_date + '|' + to_string(num_days) + '|' +
+                 to_string(min_connection) + '|' + (with_durations ? "1" : "0");
+
+    string body;
+    if (search_cache.get(key, body)) return body;
+    uint64_t epoch = search_cache.epoch();
+
+    body = find_fare_calendar(from, to, start_date, num_days, min_connection, with_durations).dump();
+    int day = FlightGraph::parse_schedule_date(start_date);
+    if (day >= 0 && num_days > 0) search_cache.put(key, day, day + num_days - 1, epoch, body);
+    return body;
+}
+
+string JsonDB::explore_json(const string& from, const string& date, int min_connection) {
+    string key = "explore|" + from + '|' + date + '|' + to_string(min_connection);
+
+    string body;
+    if (search_cache.get(key, body)) return body;
+    uint64_t epoch = search_cache.epoch();
+
+    body = find_explore_map(from, date, min_connection).dump();
+    int day = FlightGraph::parse_schedule_date(date);
+    if (day >= 0) search_cache.put(key, day, day + (CSA_HORIZON_MINUTES - 1) / 1440, epoch, body);
+    return body;
+}
+
+string JsonDB::roundtrip_json(const string& from, const string& to, const string& date,
+                              const string& return_date, int k) {
+    string key = "roundtrip|" + from + '|' + to + '|' + date + '|' + return_date + '|' + to_string(k);
+
+    string body;
+    if (search_cache.get(key, body)) return body;
+    uint64_t epoch = search_cache.epoch();
+
+    body = find_roundtrip_routes(from, to, date, return_date, k).dump();
+    int day = FlightGraph::parse_schedule_date(date);
+    int return_day = FlightGraph::parse_schedule_date(return_date);
+    if (day >= 0 && return_day >= day) search_cache.put(key, day, return_day, epoch, body);
+    return body;
+}
+
+json JsonDB::get_search_cache_stats() {
+    json stats = search_cache.stats();
+    stats["route_table"] = route_table.stats();
+    return stats;
+}
+
+// ==========================================
+// JSON IMPORT / EXPORT
+// ==========================================
+// Used by db_tool; the server itself only reads and writes the binary
+// snapshot (plus the legacy JSON file on first start).
+
+bool JsonDB::export_json(const string& path) {
+    string doc;
+    {
+        shared_lock<shared_mutex> lock(db_mutex);
+        doc = store.to_json().dump(2);
+    }
+    return WriteAheadLog::write_atomically(path, doc);
+}
+
+bool JsonDB::import_json(const string& path) {
+    json doc;
+    ifstream file(path);
+    if (!file.is_open()) return false;
+    try { file >> doc; } catch (...) { return false; }
+    if (!doc.is_object() || !doc.contains("airports")) return false;
+
+    {
+        unique_lock<shared_mutex> lock(db_mutex);
+        store.load(doc);
+        build_graph();
+        publish_airports();
+    }
+    search_cache.clear();
+    route_table.rebuild_all();
+
+    // The new snapshot supersedes every record logged so far
+    compact();
+    return true;
+}
+
 // ==========================================
 // SEEDING LOGIC
 // ==========================================
@@ -350,10 +1337,9 @@ void JsonDB::seed_data() {
         {49, "MYQ", "Mysuru", "Mysuru", 12.2300, 76.6500},
         {50, "GWL", "Gwalior", "Gwalior", 26.2936, 78.2274}
     };
-   data["airports"] = airports;
+    for (const auto& a : airports) store.add_airport(a);
 
     // 2. Generate Full Mesh Flights
-    vector<Flight> flights;
     int flight_counter = 1000;
     string airlines[] = {"IndiGo", "Air India", "Vistara", "SpiceJet", "Akasa Air"};
     
@@ -398,161 +1384,139 @@ void JsonDB::seed_data() {
                 f.duration = to_string(dur_h) + "h 00m";
                 f.price = 3000 + (rand() % 5000);
 
-                flights.push_back(f);
+                store.add_flight(f);
             }
         }
     }
 
-    data["flights"] = flights;
-    cout << "[INFO] Full Mesh Generated: " << flights.size() << " flights." << endl;
-    
-    save(); 
+    cout << "[INFO] Full Mesh Generated: " << store.live_flights() << " flights." << endl;
 }
 
 // ==========================================
 // API GETTERS & ADMIN OPS
 // ==========================================
-
-json JsonDB::get_all_airports() {
-    lock_guard<mutex> lock(db_mutex);
-    return data.value("airports", json::array());
+// Getters run concurrently under the shared lock and only call the
+// store's const members. List endpoints serialise rows straight into the
+// response body (json_stream.h) rather than building a json tree first.
+
+// Runs with db_mutex held exclusively (or during startup). Airports change
+// rarely and are read on every page load, so the body is serialised once
+// per change and readers only copy the published pointer.
+void JsonDB::publish_airports() {
+    if (replaying) return;
+    auto next = make_shared<CachedBody>();
+    append_json_array(next->body, store.airports);
+    next->etag = make_etag(next->body);
+    next->generation = ++airports_generation;
+    atomic_store(&airports_body, shared_ptr<const CachedBody>(move(next)));
 }
 
-json JsonDB::get_flights_paginated(int page, int limit, const string& query) {
-    lock_guard<mutex> lock(db_mutex);
-    json res = json::array();
-    if(data.contains("flights")) {
-        const auto& all_flights = data["flights"];
-        vector<json> filtered;
-        
-        // 1. Filter
-        if (query.empty()) {
-            for(const auto& f : all_flights) filtered.push_back(f);
-        } else {
-            string q = query;
-            transform(q.begin(), q.end(), q.begin(), ::tolower);
-            for(const auto& f : all_flights) {
-                string id = f.value("id", "");
-                string from = f.value("from_code", "");
-                string to = f.value("to_code", "");
-                string airline = f.value("airline", "");
-                
-                transform(id.begin(), id.end(), id.begin(), ::tolower);
-                transform(from.begin(), from.end(), from.begin(), ::tolower);
-                transform(to.begin(), to.end(), to.begin(), ::tolower);
-                transform(airline.begin(), airline.end(), airline.begin(), ::tolower);
-
-                if (id.find(q) != string::npos || 
-                    from.find(q) != string::npos || 
-                    to.find(q) != string::npos || 
-                    airline.find(q) != string::npos) {
-                    filtered.push_back(f);
-                }
-            }
-        }
+// ------------------------------------------
+// Flight listing: keyset pagination
+// ------------------------------------------
+// A cursor is the store's layout tag plus the row to resume from, as 16
+// hex digits. Row ids only change when the store is bulk-loaded, which
+// also changes the tag, so a cursor from before that is rejected rather
+// than silently skipping rows.
+
+static string encode_cursor(uint32_t tag, size_t row) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%08x%08x", tag, (uint32_t)row);
+    return buf;
+}
 
-        // 2. Paginate
-        int start_index = (page - 1) * limit;
-        int total = filtered.size();
+static bool decode_cursor(const string& cursor, uint32_t tag, size_t& row) {
+    unsigned int t, r;
+    if (cursor.size() != 16 || sscanf(cursor.c_str(), "%8x%8x", &t, &r) != 2 || t != tag) return false;
+    row = r;
+    return true;
+}
 
-        if (start_index < total) {
-            for (int i = start_index; i < start_index + limit && i < total; ++i) {
-                res.push_back(filtered[i]);
-            }
+size_t JsonDB::cached_flight_count(const string& query) {
+    // Caller holds db_mutex (shared), so the generation can't move under us
+    if (query.empty()) return store.live_flights();
+    string key = TrigramIndex::fold(query);
+    {
+        lock_guard<mutex> lock(count_mutex);
+        if (count_generation != store.flight_generation()) {
+            flight_counts.clear();
+            count_generation = store.flight_generation();
         }
+        auto it = flight_counts.find(key);
+        if (it != flight_counts.end()) return it->second;
     }
-    return res;
+
+    size_t total = store.count_flights(query);
+    lock_guard<mutex> lock(count_mutex);
+    if (flight_counts.size() >= FLIGHT_COUNT_CACHE) flight_counts.clear();
+    flight_counts[key] = total;
+    return total;
 }
 
-int JsonDB::get_total_flights_count(const string& query) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("flights")) return 0;
-    
-    if (query.empty()) return data["flights"].size();
+// page < 1: cursor mode, no "page" field
+string JsonDB::flights_response(const vector<size_t>& rows, size_t next_row, const string& query,
+                                int page, int limit) {
+    size_t total = cached_flight_count(query);
+    string body;
+    body.reserve(160 * rows.size() + 128);
+
+    body += "{\"flights\":";
+    append_json_array(body, store.flights, &rows);
+    body += ",\"limit\":" + to_string(limit);
+    body += ",\"next_cursor\":";
+    if (next_row == RecordStore::npos) body += "null";
+    else append_json(body, encode_cursor(store.layout_tag(), next_row));
+    if (page >= 1) body += ",\"page\":" + to_string(page);
+    body += ",\"total\":" + to_string(total);
+    body += ",\"totalPages\":" + to_string((total + limit - 1) / limit);
+    body += '}';
+    return body;
+}
 
-    int count = 0;
-    string q = query;
-    transform(q.begin(), q.end(), q.begin(), ::tolower);
+string JsonDB::list_flights(int page, int limit, const string& query) {
+    shared_lock<shared_mutex> lock(db_mutex);
+    // Page numbers stay supported: walk past the earlier pages without
+    // materialising them
+    limit = max(1, limit);
+    vector<size_t> rows;
+    size_t skip = (size_t)max(0, page - 1) * limit;
+    size_t next = store.scan_flights(query, 0, skip, limit, rows);
+    return flights_response(rows, next, query, max(1, page), limit);
+}
 
-    for(const auto& f : data["flights"]) {
-        string id = f.value("id", "");
-        string from = f.value("from_code", "");
-        string to = f.value("to_code", "");
-        string airline = f.value("airline", "");
-        
-        transform(id.begin(), id.end(), id.begin(), ::tolower);
-        transform(from.begin(), from.end(), from.begin(), ::tolower);
-        transform(to.begin(), to.end(), to.begin(), ::tolower);
-        transform(airline.begin(), airline.end(), airline.begin(), ::tolower);
-
-        if (id.find(q) != string::npos || 
-            from.find(q) != string::npos || 
-            to.find(q) != string::npos || 
-            airline.find(q) != string::npos) {
-            count++;
-        }
-    }
-    return count;
+string JsonDB::list_flights_after(const string& cursor, int limit, const string& query) {
+    shared_lock<shared_mutex> lock(db_mutex);
+    size_t from_row = 0;
+    if (!cursor.empty() && !decode_cursor(cursor, store.layout_tag(), from_row)) return "";
+
+    limit = max(1, limit);
+    vector<size_t> rows;
+    size_t next = store.scan_flights(query, from_row, 0, limit, rows);
+    return flights_response(rows, next, query, 0, limit);
 }
 
 bool JsonDB::add_airport(const Airport& apt) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("airports")) data["airports"] = json::array();
-    for(auto& x : data["airports"]) if(x["code"] == apt.code) return false;
-    json j = apt; data["airports"].push_back(j); save(); return true;
+    return mutate("add_airport", apt);
 }
 
 bool JsonDB::delete_airport(const string& code) {
-    lock_guard<mutex> lock(db_mutex);
-    if(!data.contains("airports")) return false;
-    auto& arr = data["airports"];
-    for(auto it = arr.begin(); it != arr.end(); ++it) {
-        if((*it)["code"] == code) { arr.erase(it); save(); return true; }
-    }
-    return false;
+    return mutate("delete_airport", {{"code", code}});
 }
 
 bool JsonDB::update_airport(const string& code, const json& new_data) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("airports")) return false;
-    for (auto& apt : data["airports"]) {
-        if (apt["code"] == code) {
-            for (auto& el : new_data.items()) apt[el.key()] = el.value();
-            save(); return true;
-        }
-    }
-    return false;
+    return mutate("update_airport", {{"code", code}, {"changes", new_data}});
 }
 
 bool JsonDB::add_flight(const Flight& fl) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("flights")) data["flights"] = json::array();
-    for (const auto& existing : data["flights"]) {
-        if (existing.value("id", "") == fl.id) return false;
-    }
-    json j = fl; data["flights"].push_back(j); save(); return true;
+    return mutate("add_flight", fl);
 }
 
 bool JsonDB::delete_flight(const string& id) {
-    lock_guard<mutex> lock(db_mutex);
-    if(!data.contains("flights")) return false;
-    auto& arr = data["flights"];
-    for(auto it = arr.begin(); it != arr.end(); ++it) {
-        if((*it)["id"] == id) { arr.erase(it); save(); return true; }
-    }
-    return false;
+    return mutate("delete_flight", {{"id", id}});
 }
 
 bool JsonDB::update_flight(const string& id, const json& new_data) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("flights")) return false;
-    for (auto& fl : data["flights"]) {
-        if (fl["id"] == id) {
-            for (auto& el : new_data.items()) fl[el.key()] = el.value();
-            save(); return true;
-        }
-    }
-    return false;
+    return mutate("update_flight", {{"id", id}, {"changes", new_data}});
 }
 
 // ==========================================
@@ -560,163 +1524,145 @@ bool JsonDB::update_flight(const string& id, const json& new_data) {
 // ==========================================
 
 bool JsonDB::add_booking(const Booking& booking) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("bookings")) data["bookings"] = json::array();
-    
-    // Check if booking ID already exists
-    for (const auto& existing : data["bookings"]) {
-        if (existing.value("booking_id", "") == booking.booking_id) return false;
-    }
-    
-    json j = booking;
-    data["bookings"].push_back(j);
-    save();
-    return true;
+    return mutate("add_booking", booking);
 }
 
-json JsonDB::get_all_bookings() {
-    lock_guard<mutex> lock(db_mutex);
-    return data.value("bookings", json::array());
+string JsonDB::get_all_bookings() {
+    shared_lock<shared_mutex> lock(db_mutex);
+    string body;
+    append_json_array(body, store.bookings);
+    return body;
 }
 
 json JsonDB::get_booking_by_id(const string& booking_id) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("bookings")) return json::object();
-    
-    for (const auto& booking : data["bookings"]) {
-        if (booking.value("booking_id", "") == booking_id) {
-            return booking;
-        }
-    }
-    return json::object();
+    shared_lock<shared_mutex> lock(db_mutex);
+    size_t row = store.find_booking(booking_id);
+    if (row == RecordStore::npos) return json::object();
+    return store.bookings[row];
 }
 
-json JsonDB::get_bookings_by_email(const string& email) {
-    lock_guard<mutex> lock(db_mutex);
-    json results = json::array();
-    
-    if (!data.contains("bookings")) return results;
-    
-    for (const auto& booking : data["bookings"]) {
-        if (booking.value("passenger_email", "") == email) {
-            results.push_back(booking);
-        }
-    }
-    return results;
+string JsonDB::get_bookings_by_email(const string& email) {
+    shared_lock<shared_mutex> lock(db_mutex);
+    vector<size_t> rows = store.bookings_by_email(email);
+    string body;
+    append_json_array(body, store.bookings, &rows);
+    return body;
 }
 
-json JsonDB::get_bookings_by_user_id(const string& user_id) {
-    lock_guard<mutex> lock(db_mutex);
-    json results = json::array();
-    
-    if (!data.contains("bookings")) return results;
-    
-    for (const auto& booking : data["bookings"]) {
-        if (booking.value("user_id", "") == user_id) {
-            results.push_back(booking);
-        }
-    }
-    return results;
+string JsonDB::get_bookings_by_user_id(const string& user_id) {
+    shared_lock<shared_mutex> lock(db_mutex);
+    vector<size_t> rows = store.bookings_by_user(user_id);
+    string body;
+    append_json_array(body, store.bookings, &rows);
+    return body;
 }
 
 bool JsonDB::cancel_booking(const string& booking_id) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("bookings")) return false;
-    
-    for (auto& booking : data["bookings"]) {
-        if (booking.value("booking_id", "") == booking_id) {
-            booking["status"] = "cancelled";
-            save();
-            return true;
-        }
-    }
-    return false;
+    return mutate("cancel_booking", {{"booking_id", booking_id}});
 }
 
 json JsonDB::get_admin_stats() {
-    lock_guard<mutex> lock(db_mutex);
-    
-    json stats;
-    stats["total_flights"] = data.contains("flights") ? data["flights"].size() : 0;
-    stats["total_airports"] = data.contains("airports") ? data["airports"].size() : 0;
-    
-    int total_bookings = 0;
-    long long total_revenue = 0;
-    set<string> users;
-    map<string, int> route_popularity;
-    
-    if (data.contains("bookings")) {
-        for (const auto& b : data["bookings"]) {
-            if (b.value("status", "") == "confirmed") {
-                total_bookings++;
-                total_revenue += b.value("total_price", 0);
-                users.insert(b.value("user_id", ""));
-                
-                string route = b.value("from_code", "") + " → " + b.value("to_code", "");
-                route_popularity[route]++;
-            }
-        }
-    }
-    
-    stats["total_bookings"] = total_bookings;
-    stats["total_revenue"] = total_revenue;
-    stats["total_users"] = data.contains("users") ? data["users"].size() : 0;
-    
-    // Find most popular route
-    string top_route = "N/A";
-    int max_pax = 0;
-    for (const auto& pair : route_popularity) {
-        if (pair.second > max_pax) {
-            max_pax = pair.second;
-            top_route = pair.first;
-        }
-    }
-    stats["popular_route"] = top_route;
-    stats["popular_route_count"] = max_pax;
+    shared_lock<shared_mutex> lock(db_mutex);
+    // Aggregates are maintained by the store on every mutation
+    const AdminStats& agg = store.stats();
+    json top = agg.top_routes(ADMIN_TOP_ROUTES);
 
-    // Price Extremes
-    int min_p = 999999, max_p = 0;
-    if (data.contains("flights")) {
-        for (const auto& f : data["flights"]) {
-            int p = f.value("price", 0);
-            if (p < min_p) min_p = p;
-            if (p > max_p) max_p = p;
-        }
-    }
-    stats["cheapest_price"] = (min_p == 999999) ? 0 : min_p;
-    stats["expensive_price"] = max_p;
+    json stats;
+    stats["total_flights"] = store.live_flights();
+    stats["total_airports"] = store.airports.size();
+    stats["total_bookings"] = agg.confirmed_bookings();
+    stats["total_revenue"] = agg.revenue();
+    stats["total_users"] = store.users.size();
+    stats["distinct_customers"] = agg.distinct_customers();
+
+    stats["popular_route"] = top.empty() ? json("N/A") : top[0]["route"];
+    stats["popular_route_count"] = top.empty() ? json(0) : top[0]["count"];
+    stats["top_routes"] = top;
+
+    stats["cheapest_price"] = agg.cheapest_price();
+    stats["expensive_price"] = agg.expensive_price();
     
     return stats;
 }
 
-bool JsonDB::add_user(const User& user) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("users")) {
-        data["users"] = json::array();
-    } else {
-        // Check if user already exists
-        for (const auto& u : data["users"]) {
-            if (u.value("email", "") == user.email) return false;
-        }
+json JsonDB::get_booking_analytics(const string& group_by, const string& from, const string& to, int limit) {
+    BookingAnalytics::Dimension dim;
+    if (!BookingAnalytics::parse_dimension(group_by, dim)) return json();
+    if (!from.empty() && FlightGraph::parse_date(from) < 0) return json();
+    if (!to.empty() && FlightGraph::parse_date(to) < 0) return json();
+    if (limit <= 0 || limit > ANALYTICS_MAX_GROUPS) limit = ANALYTICS_MAX_GROUPS;
+
+    shared_lock<shared_mutex> lock(db_mutex);
+    return store.analytics().query(dim, from, to, (size_t)limit);
+}
+
+// Client-facing form of a user: everything but the password hash
+static json public_user(const User& u) {
+    json j = u;
+    j.erase("password");
+    return j;
+}
+
+AuthStatus JsonDB::add_user(const User& user) {
+    {
+        // Cheap early out before paying for a hash; add_user re-checks
+        shared_lock<shared_mutex> lock(db_mutex);
+        if (store.find_user(user.email) != RecordStore::npos) return AuthStatus::Rejected;
     }
-    
-    data["users"].push_back(user);
-    save();
-    return true;
+
+    uint32_t iterations = hash_iterations;
+    string password = user.password;
+    auto hashed = auth_pool.submit([password, iterations] { return PasswordHash::hash(password, iterations); });
+    if (!hashed.valid()) return AuthStatus::Busy;
+
+    User stored = user;
+    stored.password = hashed.get();
+    return mutate("add_user", stored) ? AuthStatus::Ok : AuthStatus::Rejected;
 }
 
-json JsonDB::get_user_by_email(const string& email) {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("users")) return json::object();
-    
-    for (const auto& u : data["users"]) {
-        if (u.value("email", "") == email) return u;
+AuthStatus JsonDB::login(const string& email, const string& password, json& user) {
+    User found;
+    bool exists;
+    {
+        shared_lock<shared_mutex> lock(db_mutex);
+        size_t row = store.find_user(email);
+        exists = row != RecordStore::npos;
+        if (exists) found = store.users[row];
     }
-    return json::object();
+
+    // Unknown emails are checked against a dummy hash so that the response
+    // time doesn't reveal which addresses are registered. A match on an
+    // outdated record (plain text or fewer iterations) yields its upgrade.
+    struct Outcome { bool ok; string upgrade; };
+    uint32_t iterations = hash_iterations;
+    string stored = found.password;
+    auto verified = auth_pool.submit([=]() -> Outcome {
+        static const string dummy = PasswordHash::hash("", iterations);
+        if (!exists) {
+            PasswordHash::verify(password, dummy);
+            return {false, ""};
+        }
+        if (!PasswordHash::verify(password, stored)) return {false, ""};
+        if (PasswordHash::is_current(stored, iterations)) return {true, ""};
+        return {true, PasswordHash::hash(password, iterations)};
+    });
+    if (!verified.valid()) return AuthStatus::Busy;
+
+    Outcome outcome = verified.get();
+    if (!outcome.ok) return AuthStatus::Rejected;
+
+    if (!outcome.upgrade.empty()) {
+        // Only replaces the record we verified against; a concurrent
+        // upgrade of the same user simply wins
+        mutate("set_password", {{"email", email}, {"previous", stored}, {"password", outcome.upgrade}});
+    }
+    user = public_user(found);
+    return AuthStatus::Ok;
 }
 
-json JsonDB::get_all_users() {
-    lock_guard<mutex> lock(db_mutex);
-    if (!data.contains("users")) return json::array();
-    return data["users"];
-}
\ No newline at end of file
+string JsonDB::get_all_users() {
+    shared_lock<shared_mutex> lock(db_mutex);
+    string body;
+    append_json_array(body, store.users);
+    return body;
+}
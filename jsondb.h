@@ -2,53 +2,194 @@
 #define JSONDB_H
 
 #include <string>
+#include <cstdio>
 #include <mutex>    // <--- REQUIRED for mutex
+#include <shared_mutex>
+#include <memory>
+#include <thread>
+#include <condition_variable>
 #include <vector>
 #include <unordered_map>
 #include <nlohmann/json.hpp>
 #include "Models.h"
+#include "wal.h"
+#include "record_store.h"
+#include "snapshot.h"
+#include "flight_graph.h"
+#include "search_cache.h"
+#include "fnv.h"
+#include "thread_pool.h"
+#include "route_table.h"
 
 using json = nlohmann::json;
 
-// Internal Edge Structure for Graph Algorithms
-struct Edge {
-    std::string destination; 
-    int weight_minutes;      
-    std::string flight_id;   
-    std::string date;        
-    std::string dep_time;    
-    std::string arr_time;    
-    int price;
-    std::string airline;
+// Longest minimum connection time a search accepts, in minutes
+const int MAX_CONNECTION_MINUTES = 1440;
+
+// Parameters of one /api/search-style request (also the cache key)
+struct SearchQuery {
+    std::string mode = "smart";   // smart | earliest | pareto | cheapest
+    std::string from;
+    std::string to;
+    std::string date;
+    int k = 5;
+    int min_connection = 60;
+    int max_stops = 2;
+};
+
+// Outcome of a signup / login; Busy = the hashing pool is saturated
+enum class AuthStatus { Ok, Rejected, Busy };
+
+// A pre-serialised response body, republished whenever its source changes
+struct CachedBody {
+    std::string body;
+    std::string etag;         // strong: hash of the exact body bytes
+    uint64_t generation = 0;  // bumped on every republish
 };
 
+// Strong ETag for a response body
+inline std::string make_etag(const std::string& body) {
+    char tag[24];
+    std::snprintf(tag, sizeof(tag), "\"%016llx\"", (unsigned long long)fnv1a64(body.data(), body.size()));
+    return tag;
+}
+
 class JsonDB {
 private:
-    std::string filename;
-    json data;
-    std::mutex db_mutex; // <--- REQUIRED: This is the variable causing your error
+    std::string filename;       // legacy JSON database, imported on first start
+    std::string snapshot_path;  // binary snapshot (filename + ".snap")
+    RecordStore store;
+    // Readers take it shared, mutations take it exclusive
+    std::shared_mutex db_mutex;
+
+    // The Graph: CSR edges bucketed per (origin, day).
+    // Published RCU-style: searches grab the current immutable snapshot
+    // without touching db_mutex; flight mutations patch a copy and swap it in.
+    std::shared_ptr<const FlightGraph> graph;
+    bool replaying = false; // WAL replay: skip per-record patches, graph is built once after
+
+    // /api/airports body, rebuilt by airport mutations and read lock-free
+    std::shared_ptr<const CachedBody> airports_body;
+    uint64_t airports_generation = 0;
+
+    // Flight totals per search string, dropped on any flight mutation
+    std::mutex count_mutex;
+    std::unordered_map<std::string, size_t> flight_counts;
+    uint64_t count_generation = 0;
+
+    // Pre-serialised search responses, invalidated per day by flight mutations
+    SearchCache search_cache;
+
+    // Durability: mutations are appended to the WAL, the snapshot
+    // (snapshot_path) is only rewritten by compaction.
+    WriteAheadLog wal;
+    std::thread compactor;
+    std::mutex compact_mutex;
+    std::condition_variable compact_cv;
+    std::mutex snapshot_mutex;  // one compaction at a time
+    bool stopping = false;
+
+    // Password hashing runs here, never under db_mutex. Bounded so a
+    // login storm gets shed (AuthStatus::Busy) instead of queueing forever.
+    uint32_t hash_iterations;
+    ThreadPool auth_pool;
 
-    // The Graph: Source Code -> List of Flights
-    std::unordered_map<std::string, std::vector<Edge>> adj_list;
+    // Helpers for searches that split into independent parts (legs, days).
+    // Work is only offloaded when a slot is free, otherwise run inline.
+    ThreadPool search_pool;
+
+    // Best direct / one-stop options per (day, origin, destination), built
+    // in the background from the graph; answers most smart searches
+    RouteTable route_table;
 
     void seed_data();
-    void save();
     void build_graph(); 
+    bool make_leg(const Flight& flight, FlightLeg& leg);
+    void patch_graph(const std::string& remove_id, const Flight* add_flight);
+    std::shared_ptr<const FlightGraph> graph_snapshot() const { return std::atomic_load(&graph); }
+    static json segment_json(const FlightGraph& g, int from, const Edge& e);
+    static json route_json(const FlightGraph& g, int from, const std::vector<const Edge*>& path, int total_minutes);
     int parse_duration_string(const std::string& dur);
 
+    size_t cached_flight_count(const std::string& query);
+    void publish_airports();
+    std::string flights_response(const std::vector<size_t>& rows, size_t next_row, const std::string& query,
+                                 int page, int limit);
+
+    // Mutation plumbing (apply_record expects db_mutex to be held)
+    bool apply_record(const std::string& op, const json& payload);
+    bool mutate(const std::string& op, const json& payload);
+    void compact();
+    void compaction_loop();
+
 public:
     JsonDB(const std::string& fname);
+    ~JsonDB();
 
     // Read APIs
-    json get_all_airports();
-    json get_flights_paginated(int page, int limit, const std::string& query = "");
-    int get_total_flights_count(const std::string& query = "");
+    // List endpoints return the serialised response body
+    std::shared_ptr<const CachedBody> get_airports_body() const { return std::atomic_load(&airports_body); }
+    // {"flights", "total", "totalPages", "limit", "page", "next_cursor"};
+    // next_cursor is null on the last page
+    std::string list_flights(int page, int limit, const std::string& query = "");
+    // Keyset variant: resumes from an opaque cursor ("" = first page);
+    // returns "" if the cursor is malformed or expired
+    std::string list_flights_after(const std::string& cursor, int limit, const std::string& query = "");
     
-    // Smart Search
+    // Smart Search (from the route table when it can answer exactly)
     json find_smart_routes(const std::string& src, const std::string& dst, const std::string& date, int k = 5);
 
-    // Bellman-Ford Search (Single Best Path)
-    json find_bellman_route(const std::string& src, const std::string& dst, const std::string& date);
+    // Connection Scan: earliest arrival with a minimum connection time
+    json find_earliest_arrival(const std::string& src, const std::string& dst, const std::string& date, int min_connection = 60);
+
+    // Pareto front of (duration, price, stops) in one multi-criteria pass
+    json find_pareto_routes(const std::string& src, const std::string& dst, const std::string& date,
+                            int max_stops = 2, int min_connection = 60);
+
+    // Cheapest fare (Single Best Path), respecting connection times
+    json find_cheapest_route(const std::string& src, const std::string& dst, const std::string& date, int min_connection = 60);
+
+    // Round trip: k-shortest on both legs over one graph snapshot, in
+    // parallel; pairs whose return leaves after the outbound lands, pruned
+    // to the (total price, total time) Pareto front, cheapest first, <= k.
+    // [{"total_price", "total_time", "duration_fmt", "outbound", "return"}]
+    json find_roundtrip_routes(const std::string& src, const std::string& dst, const std::string& date,
+                               const std::string& return_date, int k = 5);
+
+    // Multi-city: one k-shortest search per leg (concurrently, one graph
+    // snapshot), merged best-first by total price ('by_time': total
+    // minutes). Consecutive legs need 'min_connection' minutes between
+    // landing and the next departure. Empty if any leg is invalid.
+    // [{"total_price", "total_time", "duration_fmt", "legs": [route...]}]
+    json find_multicity_routes(const std::vector<SearchQuery>& legs, int k = 5, int min_connection = 60,
+                               bool by_time = false);
+
+    // Fare calendar: the cheapest fare (as find_cheapest_route) for each of
+    // 'num_days' days from 'start_date', days solved in parallel; with
+    // 'with_durations' also the smart-search best total time per day.
+    // {"from", "to", "days": [{"date", "price", "stops", "departure",
+    //   "duration_fmt", "fastest_time"}], "cheapest_date", "cheapest_price"}
+    json find_fare_calendar(const std::string& src, const std::string& dst, const std::string& start_date,
+                            int num_days, int min_connection = 60, bool with_durations = false);
+
+    // Explore map: from one origin and date, the cheapest same-day fare
+    // (Dijkstra, no target) and the earliest arrival (Connection Scan over
+    // the horizon) to every reachable airport, each with its path.
+    // {"origin", "date", "destinations": [{"code", "cheapest", "fastest"}]}
+    json find_explore_map(const std::string& src, const std::string& date, int min_connection = 60);
+
+    // Cached dispatcher for the search modes above: returns the response body
+    std::string search_json(const SearchQuery& q);
+    std::string roundtrip_json(const std::string& from, const std::string& to, const std::string& date,
+                               const std::string& return_date, int k = 5);
+    std::string explore_json(const std::string& from, const std::string& date, int min_connection = 60);
+    std::string calendar_json(const std::string& from, const std::string& to, const std::string& start_date,
+                              int num_days, int min_connection = 60, bool with_durations = false);
+    json get_search_cache_stats();
+
+    // JSON tooling (db_tool): export the store / replace it from a file
+    bool export_json(const std::string& path);
+    bool import_json(const std::string& path);
 
     // Admin APIs
     bool add_airport(const Airport& airport);
@@ -61,18 +202,23 @@ public:
 
     // Booking APIs
     bool add_booking(const Booking& booking);
-    json get_all_bookings();
+    std::string get_all_bookings();
     json get_booking_by_id(const std::string& booking_id);
-    json get_bookings_by_email(const std::string& email);
-    json get_bookings_by_user_id(const std::string& user_id);
+    std::string get_bookings_by_email(const std::string& email);
+    std::string get_bookings_by_user_id(const std::string& user_id);
     bool cancel_booking(const std::string& booking_id);
     // Admin Stats
     json get_admin_stats();
+    // Booking analytics grouped by day|route|airline|flight over booking
+    // days [from, to] ("YYYY-MM-DD", empty = open); null on a bad parameter
+    json get_booking_analytics(const std::string& group_by, const std::string& from,
+                               const std::string& to, int limit);
 
-    // User management
-    bool add_user(const User& user);
-    json get_user_by_email(const std::string& email);
-    json get_all_users();
+    // User management. Passwords are stored as PBKDF2 hashes and never
+    // returned; Rejected = duplicate email / wrong credentials.
+    AuthStatus add_user(const User& user);
+    AuthStatus login(const std::string& email, const std::string& password, json& user);
+    std::string get_all_users();
 };
 
 #endif
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "crow.h"
 #include "jsondb.h"
+#include "session_store.h"
 #include "Models.h"
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <nlohmann/json.hpp>
@@ -31,14 +33,71 @@ struct CORSHandler {
         res.add_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
         res.add_header("Access-Control-Allow-Headers", "Content-Type, Authorization, X-Requested-With");
         res.add_header("Access-Control-Allow-Credentials", "true");
+        res.add_header("Access-Control-Expose-Headers", "ETag");
     }
 };
 
+// ==========================================
+// SESSION MIDDLEWARE
+// ==========================================
+// Logins hand out bearer tokens; a session lasts a day
+SessionStore sessions(std::chrono::hours(24));
+
+// Resolves "Authorization: Bearer <token>" once per request. Routes read
+// the outcome from the context; requests without a token pass through
+// untouched, so public endpoints are unaffected.
+struct AuthHandler {
+    struct context {
+        bool authenticated = false;
+        bool rejected = false;     // a token was sent but is unknown or expired
+        Session session;
+    };
+
+    void before_handle(crow::request& req, crow::response& res, context& ctx) {
+        const std::string& header = req.get_header_value("Authorization");
+        static const std::string scheme = "Bearer ";
+        if (header.compare(0, scheme.size(), scheme) != 0) return;
+        ctx.authenticated = sessions.find(header.substr(scheme.size()), ctx.session);
+        ctx.rejected = !ctx.authenticated;
+    }
+
+    void after_handle(crow::request& req, crow::response& res, context& ctx) {}
+};
+
 JsonDB db("flight_database.json");
 
+// ==========================================
+// CONDITIONAL GET
+// ==========================================
+// Strong-ETag revalidation: clients that already hold this exact body get
+// an empty 304. "no-cache" makes browsers revalidate instead of guessing.
+static crow::response with_etag(const crow::request& req, const std::string& etag, std::string body) {
+    crow::response res;
+    res.add_header("ETag", etag);
+    res.add_header("Cache-Control", "no-cache");
+
+    const std::string& if_none_match = req.get_header_value("If-None-Match");
+    if (!if_none_match.empty() && (if_none_match == "*" || if_none_match.find(etag) != std::string::npos)) {
+        res.code = 304;
+        return res;
+    }
+    res.body = std::move(body);
+    return res;
+}
+
+// Session-only routes answer 401 with a JSON body the pages can parse
+static crow::response unauthorized(const std::string& message) {
+    return crow::response(401, json({{"success", false}, {"message", message}}).dump());
+}
+
+// Range accepted for the min_connection parameter (minutes)
+static bool valid_connection(int minutes) {
+    return minutes >= 0 && minutes <= MAX_CONNECTION_MINUTES;
+}
+
 
 int main() {
-    crow::App<CORSHandler> app;
+    crow::App<CORSHandler, AuthHandler> app;
 
     // ==========================================
     // 1. PUBLIC ROUTES
@@ -54,16 +113,23 @@ int main() {
             {"endpoints", {
                 {"/health", "Health check"},
                 {"/api/airports", "Get all airports"},
-                {"/api/flights", "Get flights (limit parameter)"},
-                {"/api/search", "Search flights (from, to, date parameters)"}
+                {"/api/flights", "Get flights (limit, search, page or cursor parameters)"},
+                {"/api/search", "Search flights (from, to, date parameters; mode=earliest|pareto)"},
+                {"/api/search/roundtrip", "Paired round trips (from, to, date, return_date, k)"},
+                {"/api/explore", "Cheapest and fastest to every airport (from, date, min_connection)"},
+                {"/api/search/calendar", "Cheapest fare per day (from, to, start, days, min_connection, durations)"},
+                {"/api/search/multicity", "POST - Multi-city itineraries ({legs: [{from, to, date}], k, min_connection, sort})"}
             }},
             {"booking", {
-                {"/api/booking/create", "POST - Create booking with payment"},
-                {"/api/booking/get", "GET - Get booking by ID"},
+                {"/api/booking/create", "POST - Create booking with payment (Authorization: Bearer)"},
+                {"/api/booking/get", "GET - One of the session user's bookings by ID (Authorization: Bearer)"},
                 {"/api/bookings", "GET - Get all bookings"},
-                {"/api/booking/user", "GET - Get bookings by email"},
-                {"/api/booking/cancel", "POST - Cancel booking"},
-                {"/api/admin/stats", "GET - Get real business stats"}
+                {"/api/booking/user", "GET - Bookings by the session user's own email (Authorization: Bearer)"},
+                {"/api/booking/history", "GET - Bookings of the session user (Authorization: Bearer)"},
+                {"/api/booking/cancel", "POST - Cancel one of the session user's bookings (Authorization: Bearer)"},
+                {"/api/admin/stats", "GET - Get real business stats"},
+                {"/api/admin/analytics", "GET - Booking analytics (group_by=day|route|airline|flight, from, to, limit)"},
+                {"/api/admin/cache-stats", "GET - Search cache hit/miss counters"}
             }},
             {"admin", {
                 {"/admin/airport/add", "POST - Add airport"},
@@ -83,8 +149,10 @@ int main() {
     });
     
     CROW_ROUTE(app, "/api/airports")
-    ([](){
-        return crow::response(db.get_all_airports().dump());
+    ([](const crow::request& req){
+        // Pre-serialised on change; no lock and no serialisation here
+        std::shared_ptr<const CachedBody> airports = db.get_airports_body();
+        return with_etag(req, airports->etag, airports->body);
     });
 
     CROW_ROUTE(app, "/api/flights")
@@ -96,15 +164,14 @@ int main() {
         if (req.url_params.get("page")) page = std::stoi(req.url_params.get("page"));
         if (req.url_params.get("limit")) limit = std::stoi(req.url_params.get("limit"));
         if (req.url_params.get("search")) query = req.url_params.get("search");
-        
-        json response;
-        response["flights"] = db.get_flights_paginated(page, limit, query);
-        response["total"] = db.get_total_flights_count(query);
-        response["page"] = page;
-        response["limit"] = limit;
-        response["totalPages"] = (response["total"].get<int>() + limit - 1) / limit;
 
-        return crow::response(response.dump());
+        // ?cursor= (from a previous next_cursor) pages by key; ?page= still works
+        const char* cursor = req.url_params.get("cursor");
+        if (!cursor) return crow::response(db.list_flights(page, limit, query));
+
+        std::string body = db.list_flights_after(cursor, limit, query);
+        if (body.empty()) return crow::response(400, "Invalid or expired cursor");
+        return crow::response(std::move(body));
     });
 
     CROW_ROUTE(app, "/api/search")
@@ -115,8 +182,117 @@ int main() {
         if (req.url_params.get("date")) date = req.url_params.get("date");
 
         if (!src || !dst) return crow::response(400, "Missing parameters");
-        
-        return crow::response(db.find_smart_routes(src, dst, date, 5).dump());
+
+        // mode=earliest: Connection Scan earliest-arrival
+        // mode=pareto:   price x duration x stops front in one pass (comparison view)
+        SearchQuery q;
+        q.from = src;
+        q.to = dst;
+        q.date = date;
+        if (req.url_params.get("mode")) q.mode = req.url_params.get("mode");
+        try {
+            if (req.url_params.get("min_connection")) q.min_connection = std::stoi(req.url_params.get("min_connection"));
+            if (req.url_params.get("max_stops")) q.max_stops = std::stoi(req.url_params.get("max_stops"));
+        } catch (...) { return crow::response(400, "Invalid parameters"); }
+        if (!valid_connection(q.min_connection)) return crow::response(400, "min_connection must be 0-1440");
+
+        std::string body = db.search_json(q);
+        std::string etag = make_etag(body);
+        return with_etag(req, etag, std::move(body));
+    });
+
+    // Both legs in one call, paired and pruned server-side
+    CROW_ROUTE(app, "/api/search/roundtrip")
+    ([](const crow::request& req){
+        const char* src = req.url_params.get("from");
+        const char* dst = req.url_params.get("to");
+        const char* date = req.url_params.get("date");
+        const char* return_date = req.url_params.get("return_date");
+        if (!src || !dst || !date || !return_date) return crow::response(400, "Missing parameters");
+
+        int k = 5;
+        try {
+            if (req.url_params.get("k")) k = std::stoi(req.url_params.get("k"));
+        } catch (...) { return crow::response(400, "Invalid parameters"); }
+        k = std::max(1, std::min(k, 20));
+
+        std::string body = db.roundtrip_json(src, dst, date, return_date, k);
+        std::string etag = make_etag(body);
+        return with_etag(req, etag, std::move(body));
+    });
+
+    // Cheapest / fastest to every airport from one origin (explore map)
+    CROW_ROUTE(app, "/api/explore")
+    ([](const crow::request& req){
+        const char* src = req.url_params.get("from");
+        if (!src) return crow::response(400, "Missing parameters");
+        std::string date = "2025-12-01";
+        if (req.url_params.get("date")) date = req.url_params.get("date");
+
+        int min_connection = 60;
+        try {
+            if (req.url_params.get("min_connection")) min_connection = std::stoi(req.url_params.get("min_connection"));
+        } catch (...) { return crow::response(400, "Invalid parameters"); }
+        if (!valid_connection(min_connection)) return crow::response(400, "min_connection must be 0-1440");
+
+        std::string body = db.explore_json(src, date, min_connection);
+        std::string etag = make_etag(body);
+        return with_etag(req, etag, std::move(body));
+    });
+
+    // Cheapest fare per day over a window (flexible dates)
+    CROW_ROUTE(app, "/api/search/calendar")
+    ([](const crow::request& req){
+        const char* src = req.url_params.get("from");
+        const char* dst = req.url_params.get("to");
+        const char* start = req.url_params.get("start");
+        if (!src || !dst || !start) return crow::response(400, "Missing parameters");
+
+        int days = 30, min_connection = 60;
+        try {
+            if (req.url_params.get("days")) days = std::stoi(req.url_params.get("days"));
+            if (req.url_params.get("min_connection")) min_connection = std::stoi(req.url_params.get("min_connection"));
+        } catch (...) { return crow::response(400, "Invalid parameters"); }
+        if (days < 1 || days > 62) return crow::response(400, "days must be 1-62");
+        if (!valid_connection(min_connection)) return crow::response(400, "min_connection must be 0-1440");
+        bool durations = req.url_params.get("durations") != nullptr;
+
+        std::string body = db.calendar_json(src, dst, start, days, min_connection, durations);
+        std::string etag = make_etag(body);
+        return with_etag(req, etag, std::move(body));
+    });
+
+    // Ordered legs [{"from", "to", "date"}, ...], solved in one call
+    CROW_ROUTE(app, "/api/search/multicity").methods(crow::HTTPMethod::POST, crow::HTTPMethod::OPTIONS)
+    ([](const crow::request& req){
+        if (req.method == crow::HTTPMethod::OPTIONS) return crow::response(204);
+
+        auto body = json::parse(req.body, nullptr, false);
+        if (body.is_discarded() || !body.contains("legs") || !body["legs"].is_array()) {
+            return crow::response(400, "Invalid JSON");
+        }
+        if (body["legs"].empty() || body["legs"].size() > 6) return crow::response(400, "Between 1 and 6 legs");
+
+        std::vector<SearchQuery> legs;
+        int k = 5, min_connection = 60;
+        bool by_time = false;
+        try {
+            for (const auto& l : body["legs"]) {
+                SearchQuery leg;
+                leg.from = l.at("from").get<std::string>();
+                leg.to = l.at("to").get<std::string>();
+                leg.date = l.at("date").get<std::string>();
+                if (leg.from == leg.to) return crow::response(400, "Each leg needs two different airports");
+                legs.push_back(leg);
+            }
+            k = body.value("k", 5);
+            min_connection = body.value("min_connection", 60);
+            by_time = body.value("sort", std::string("price")) == "time";
+        } catch (...) { return crow::response(400, "Invalid parameters"); }
+        k = std::max(1, std::min(k, 20));
+        if (!valid_connection(min_connection)) return crow::response(400, "min_connection must be 0-1440");
+
+        return crow::response(db.find_multicity_routes(legs, k, min_connection, by_time).dump());
     });
 
     CROW_ROUTE(app, "/api/search-bellman")
@@ -127,8 +303,21 @@ int main() {
         if (req.url_params.get("date")) date = req.url_params.get("date");
 
         if (!src || !dst) return crow::response(400, "Missing parameters");
+
+        // Kept under its old path; now a time-aware cheapest-fare search
+        SearchQuery q;
+        q.mode = "cheapest";
+        q.from = src;
+        q.to = dst;
+        q.date = date;
+        try {
+            if (req.url_params.get("min_connection")) q.min_connection = std::stoi(req.url_params.get("min_connection"));
+        } catch (...) { return crow::response(400, "Invalid min_connection"); }
+        if (!valid_connection(q.min_connection)) return crow::response(400, "min_connection must be 0-1440");
         
-        return crow::response(db.find_bellman_route(src, dst, date).dump());
+        std::string body = db.search_json(q);
+        std::string etag = make_etag(body);
+        return with_etag(req, etag, std::move(body));
     });
 
 
@@ -223,7 +412,7 @@ int main() {
 
     // CREATE BOOKING (with simulated payment)
     CROW_ROUTE(app, "/api/booking/create").methods(crow::HTTPMethod::POST, crow::HTTPMethod::OPTIONS)
-    ([](const crow::request& req){
+    ([&](const crow::request& req){
         if (req.method == crow::HTTPMethod::OPTIONS) return crow::response(200);
 
         auto body = json::parse(req.body, nullptr, false);
@@ -240,7 +429,10 @@ int main() {
 
             Booking booking;
             booking.booking_id = booking_id;
-            booking.user_id = body.value("user_id", "");  // Unique user identifier
+            // Bookings belong to the session's user, never to a user_id from the body
+            auto& auth = app.get_context<AuthHandler>(req);
+            if (!auth.authenticated) return unauthorized(auth.rejected ? "Session expired" : "Not logged in");
+            booking.user_id = auth.session.user_id;
             booking.flight_id = body.value("flight_id", "");
             booking.passenger_name = body.value("passenger_name", "");
             booking.passenger_email = body.value("passenger_email", "");
@@ -269,41 +461,53 @@ int main() {
 
     // GET BOOKING BY ID
     CROW_ROUTE(app, "/api/booking/get")
-    ([](const crow::request& req){
+    ([&](const crow::request& req){
+        auto& auth = app.get_context<AuthHandler>(req);
+        if (!auth.authenticated) return unauthorized(auth.rejected ? "Session expired" : "Not logged in");
         const char* id = req.url_params.get("id");
         if (!id) return crow::response(400, "Missing id parameter");
         
+        // Someone else's booking looks the same as a missing one
         json booking = db.get_booking_by_id(id);
-        if (booking.empty()) return crow::response(404, "Booking not found");
+        if (booking.empty() || booking.value("user_id", "") != auth.session.user_id) {
+            return crow::response(404, "Booking not found");
+        }
         return crow::response(booking.dump());
     });
 
     // GET ALL BOOKINGS (Admin)
     CROW_ROUTE(app, "/api/bookings")
     ([](){
-        return crow::response(db.get_all_bookings().dump());
+        return crow::response(db.get_all_bookings());
     });
 
     // GET BOOKINGS BY EMAIL
     CROW_ROUTE(app, "/api/booking/user")
-    ([](const crow::request& req){
+    ([&](const crow::request& req){
+        auto& auth = app.get_context<AuthHandler>(req);
+        if (!auth.authenticated) return unauthorized(auth.rejected ? "Session expired" : "Not logged in");
         const char* email = req.url_params.get("email");
         if (!email) return crow::response(400, "Missing email parameter");
-        return crow::response(db.get_bookings_by_email(email).dump());
+        // Only the session user's own email
+        if (email != auth.session.email) return crow::response(403, "Not your email");
+        return crow::response(db.get_bookings_by_email(email));
     });
 
     // GET BOOKINGS BY USER ID (Recommended - more reliable)
     CROW_ROUTE(app, "/api/booking/history")
-    ([](const crow::request& req){
-        const char* user_id = req.url_params.get("user_id");
-        if (!user_id) return crow::response(400, "Missing user_id parameter");
-        return crow::response(db.get_bookings_by_user_id(user_id).dump());
+    ([&](const crow::request& req){
+        // Only ever the session user's own history
+        auto& auth = app.get_context<AuthHandler>(req);
+        if (!auth.authenticated) return unauthorized(auth.rejected ? "Session expired" : "Not logged in");
+        return crow::response(db.get_bookings_by_user_id(auth.session.user_id));
     });
 
     // CANCEL BOOKING
     CROW_ROUTE(app, "/api/booking/cancel").methods(crow::HTTPMethod::POST, crow::HTTPMethod::OPTIONS)
-    ([](const crow::request& req){
+    ([&](const crow::request& req){
         if (req.method == crow::HTTPMethod::OPTIONS) return crow::response(200);
+        auto& auth = app.get_context<AuthHandler>(req);
+        if (!auth.authenticated) return unauthorized(auth.rejected ? "Session expired" : "Not logged in");
 
         auto body = json::parse(req.body, nullptr, false);
         if (body.is_discarded()) return crow::response(400, "Invalid JSON");
@@ -311,6 +515,12 @@ int main() {
         std::string booking_id = body.value("booking_id", "");
         if (booking_id.empty()) return crow::response(400, "Missing booking_id");
 
+        // Only the session user's own bookings; others look missing
+        json booking = db.get_booking_by_id(booking_id);
+        if (booking.empty() || booking.value("user_id", "") != auth.session.user_id) {
+            return crow::response(404, "Booking not found");
+        }
+
         if (db.cancel_booking(booking_id)) {
             json response = {
                 {"success", true},
@@ -329,6 +539,28 @@ int main() {
         return crow::response(db.get_admin_stats().dump());
     });
 
+    // BOOKING ANALYTICS
+    CROW_ROUTE(app, "/api/admin/analytics")
+    ([&](const crow::request& req){
+        const char* group_by = req.url_params.get("group_by");
+        const char* from = req.url_params.get("from");
+        const char* to = req.url_params.get("to");
+        int limit = 50;
+        try {
+            if (req.url_params.get("limit")) limit = std::stoi(req.url_params.get("limit"));
+        } catch (...) { return crow::response(400, "Invalid limit"); }
+
+        json result = db.get_booking_analytics(group_by ? group_by : "day", from ? from : "", to ? to : "", limit);
+        if (result.is_null()) return crow::response(400, "Invalid group_by or date range");
+        return crow::response(result.dump());
+    });
+
+    // SEARCH CACHE COUNTERS
+    CROW_ROUTE(app, "/api/admin/cache-stats")
+    ([&](){
+        return crow::response(db.get_search_cache_stats().dump());
+    });
+
     // ==========================================
     // 3. USER MANAGEMENT ROUTES
     // ==========================================
@@ -345,9 +577,13 @@ int main() {
         u.password = x.value("password", "");
         u.created_at = x.value("created_at", "");
         
-        if (db.add_user(u)) {
+        AuthStatus status = db.add_user(u);
+        if (status == AuthStatus::Ok) {
             return crow::response(200, json({{"success", true}, {"message", "User created"}}).dump());
         }
+        if (status == AuthStatus::Busy) {
+            return crow::response(503, json({{"success", false}, {"message", "Server busy, please retry"}}).dump());
+        }
         return crow::response(400, json({{"success", false}, {"message", "Email already exists"}}).dump());
     });
 
@@ -359,16 +595,46 @@ int main() {
         std::string email = x.value("email", "");
         std::string password = x.value("password", "");
         
-        json u = db.get_user_by_email(email);
-        if (!u.empty() && u.value("password", "") == password) {
-            return crow::response(200, json({{"success", true}, {"user", u}}).dump());
+        json u;
+        AuthStatus status = db.login(email, password, u);
+        if (status == AuthStatus::Ok) {
+            std::string token = sessions.create(u.value("id", ""), u.value("email", ""), u.value("name", ""));
+            return crow::response(200, json({
+                {"success", true},
+                {"user", u},
+                {"token", token},
+                {"expires_in", sessions.ttl().count()}
+            }).dump());
+        }
+        if (status == AuthStatus::Busy) {
+            return crow::response(503, json({{"success", false}, {"message", "Server busy, please retry"}}).dump());
         }
         return crow::response(401, json({{"success", false}, {"message", "Invalid credentials"}}).dump());
     });
 
+    CROW_ROUTE(app, "/api/user/logout")
+    .methods(crow::HTTPMethod::POST, crow::HTTPMethod::OPTIONS)
+    ([&](const crow::request& req){
+        if (req.method == crow::HTTPMethod::OPTIONS) return crow::response(204);
+        const std::string& header = req.get_header_value("Authorization");
+        if (header.compare(0, 7, "Bearer ") == 0) sessions.revoke(header.substr(7));
+        return crow::response(200, json({{"success", true}}).dump());
+    });
+
+    // Current session's user, straight from the token
+    CROW_ROUTE(app, "/api/user/me")
+    ([&](const crow::request& req){
+        auto& auth = app.get_context<AuthHandler>(req);
+        if (!auth.authenticated) return unauthorized("Not logged in");
+        return crow::response(json({
+            {"success", true},
+            {"user", {{"id", auth.session.user_id}, {"email", auth.session.email}, {"name", auth.session.name}}}
+        }).dump());
+    });
+
     CROW_ROUTE(app, "/api/users")
     ([&](){
-        return crow::response(db.get_all_users().dump());
+        return crow::response(db.get_all_users());
     });
 
     // CATCH-ALL
@@ -0,0 +1,286 @@
+#include "password_hash.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static const char HASH_SCHEME[] = "pbkdf2-sha256";
+static const size_t SALT_BYTES = 16;
+static const size_t KEY_BYTES = 32;
+
+// ==========================================
+// SHA-256 (FIPS 180-4)
+// ==========================================
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t SHA256_INIT[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static inline uint32_t load_be32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static inline void store_be32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+static void sha256_compress(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) w[i] = load_be32(block + 4 * i);
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+// Streaming SHA-256
+struct Sha256 {
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered = 0;
+    uint64_t total = 0;
+
+    Sha256() { memcpy(state, SHA256_INIT, sizeof(state)); }
+
+    void update(const uint8_t* data, size_t len) {
+        total += len;
+        while (len > 0) {
+            size_t take = min(len, sizeof(buffer) - buffered);
+            memcpy(buffer + buffered, data, take);
+            buffered += take; data += take; len -= take;
+            if (buffered == sizeof(buffer)) {
+                sha256_compress(state, buffer);
+                buffered = 0;
+            }
+        }
+    }
+
+    void finish(uint8_t out[32]) {
+        uint64_t bits = total * 8;
+        uint8_t pad = 0x80;
+        update(&pad, 1);
+        uint8_t zero = 0;
+        while (buffered != 56) update(&zero, 1);
+        uint8_t len_be[8];
+        for (int i = 0; i < 8; ++i) len_be[i] = (uint8_t)(bits >> (56 - 8 * i));
+        update(len_be, 8);
+        for (int i = 0; i < 8; ++i) store_be32(out + 4 * i, state[i]);
+    }
+};
+
+// ==========================================
+// HMAC / PBKDF2
+// ==========================================
+
+// HMAC-SHA256 with the key-dependent pad blocks absorbed once. Each PBKDF2
+// round then costs exactly two compressions: the 32-byte message and the
+// 32-byte inner digest both fit in a single padded block after the pad.
+struct HmacSha256 {
+    uint32_t inner[8];
+    uint32_t outer[8];
+
+    explicit HmacSha256(const string& key) {
+        uint8_t k[64] = {0};
+        if (key.size() > sizeof(k)) {
+            Sha256 h;
+            h.update((const uint8_t*)key.data(), key.size());
+            h.finish(k);
+        } else {
+            memcpy(k, key.data(), key.size());
+        }
+        uint8_t ipad[64], opad[64];
+        for (int i = 0; i < 64; ++i) {
+            ipad[i] = k[i] ^ 0x36;
+            opad[i] = k[i] ^ 0x5c;
+        }
+        memcpy(inner, SHA256_INIT, sizeof(inner));
+        memcpy(outer, SHA256_INIT, sizeof(outer));
+        sha256_compress(inner, ipad);
+        sha256_compress(outer, opad);
+    }
+
+    // HMAC of an arbitrary message (used for the first block of each round)
+    void mac(const uint8_t* msg, size_t len, uint8_t out[32]) const {
+        Sha256 h;
+        memcpy(h.state, inner, sizeof(inner));
+        h.total = 64;
+        h.update(msg, len);
+        uint8_t digest[32];
+        h.finish(digest);
+        finish_outer(digest, out);
+    }
+
+    // HMAC of a 32-byte message, two compressions
+    void mac32(const uint8_t msg[32], uint8_t out[32]) const {
+        uint8_t digest[32];
+        single_block(inner, msg, digest);
+        finish_outer(digest, out);
+    }
+
+private:
+    void finish_outer(const uint8_t digest[32], uint8_t out[32]) const { single_block(outer, digest, out); }
+
+    // Hash of (64-byte pad || 32-byte msg) given the state after the pad
+    static void single_block(const uint32_t from[8], const uint8_t msg[32], uint8_t out[32]) {
+        uint8_t block[64] = {0};
+        memcpy(block, msg, 32);
+        block[32] = 0x80;
+        store_be32(block + 60, (64 + 32) * 8);
+        uint32_t st[8];
+        memcpy(st, from, sizeof(st));
+        sha256_compress(st, block);
+        for (int i = 0; i < 8; ++i) store_be32(out + 4 * i, st[i]);
+    }
+};
+
+void PasswordHash::pbkdf2_sha256(const string& password, const uint8_t* salt, size_t salt_len,
+                                 uint32_t iterations, uint8_t* out, size_t out_len) {
+    HmacSha256 prf(password);
+    vector<uint8_t> first(salt, salt + salt_len);
+    first.resize(salt_len + 4);
+
+    for (uint32_t block = 1; out_len > 0; ++block) {
+        store_be32(first.data() + salt_len, block);
+        uint8_t u[32], t[32];
+        prf.mac(first.data(), first.size(), u);
+        memcpy(t, u, sizeof(t));
+        for (uint32_t i = 1; i < iterations; ++i) {
+            prf.mac32(u, u);
+            for (int j = 0; j < 32; ++j) t[j] ^= u[j];
+        }
+        size_t take = min(out_len, sizeof(t));
+        memcpy(out, t, take);
+        out += take;
+        out_len -= take;
+    }
+}
+
+// ==========================================
+// STORED FORM
+// ==========================================
+
+static string to_hex(const uint8_t* p, size_t n) {
+    static const char digits[] = "0123456789abcdef";
+    string s(n * 2, '0');
+    for (size_t i = 0; i < n; ++i) {
+        s[2 * i] = digits[p[i] >> 4];
+        s[2 * i + 1] = digits[p[i] & 15];
+    }
+    return s;
+}
+
+static bool from_hex(const string& s, vector<uint8_t>& out) {
+    if (s.size() % 2) return false;
+    auto nibble = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    out.resize(s.size() / 2);
+    for (size_t i = 0; i < out.size(); ++i) {
+        int hi = nibble(s[2 * i]), lo = nibble(s[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+static bool equal_constant_time(const uint8_t* a, size_t a_len, const uint8_t* b, size_t b_len) {
+    // Runs over the full length of 'a' whatever the inputs, so timing
+    // reveals neither the mismatch position nor (for hashes) anything else
+    uint8_t diff = a_len != b_len;
+    for (size_t i = 0; i < a_len; ++i) diff |= a[i] ^ (i < b_len ? b[i] : 0);
+    return diff == 0;
+}
+
+struct ParsedHash {
+    uint32_t iterations = 0;
+    vector<uint8_t> salt;
+    vector<uint8_t> key;
+};
+
+static bool parse_hash(const string& stored, ParsedHash& h) {
+    const size_t prefix = sizeof(HASH_SCHEME) - 1;
+    if (stored.compare(0, prefix, HASH_SCHEME) != 0 || stored.size() <= prefix || stored[prefix] != '$') return false;
+
+    size_t a = prefix + 1;
+    size_t b = stored.find('$', a);
+    if (b == string::npos) return false;
+    size_t c = stored.find('$', b + 1);
+    if (c == string::npos) return false;
+
+    char* end = nullptr;
+    unsigned long iters = strtoul(stored.c_str() + a, &end, 10);
+    if (end != stored.c_str() + b || iters == 0 || iters > UINT32_MAX) return false;
+    h.iterations = (uint32_t)iters;
+    return from_hex(stored.substr(b + 1, c - b - 1), h.salt) &&
+           from_hex(stored.substr(c + 1), h.key) && !h.key.empty();
+}
+
+uint32_t PasswordHash::configured_iterations() {
+    static const uint32_t iterations = [] {
+        const char* env = getenv("PASSWORD_HASH_ITERATIONS");
+        if (!env) return DEFAULT_ITERATIONS;
+        unsigned long v = strtoul(env, nullptr, 10);
+        if (v < MIN_ITERATIONS) return MIN_ITERATIONS;
+        return v > UINT32_MAX ? (uint32_t)UINT32_MAX : (uint32_t)v;
+    }();
+    return iterations;
+}
+
+string PasswordHash::hash(const string& password, uint32_t iterations) {
+    static thread_local mt19937_64 rng(random_device{}());
+    uint8_t salt[SALT_BYTES];
+    for (size_t i = 0; i < SALT_BYTES; i += 8) {
+        uint64_t r = rng();
+        memcpy(salt + i, &r, min<size_t>(8, SALT_BYTES - i));
+    }
+    uint8_t key[KEY_BYTES];
+    pbkdf2_sha256(password, salt, SALT_BYTES, iterations, key, KEY_BYTES);
+    return string(HASH_SCHEME) + "$" + to_string(iterations) + "$" + to_hex(salt, SALT_BYTES) + "$" +
+           to_hex(key, KEY_BYTES);
+}
+
+bool PasswordHash::verify(const string& password, const string& stored) {
+    ParsedHash h;
+    if (!parse_hash(stored, h)) {
+        return equal_constant_time((const uint8_t*)stored.data(), stored.size(),
+                                   (const uint8_t*)password.data(), password.size());
+    }
+    vector<uint8_t> key(h.key.size());
+    pbkdf2_sha256(password, h.salt.data(), h.salt.size(), h.iterations, key.data(), key.size());
+    return equal_constant_time(h.key.data(), h.key.size(), key.data(), key.size());
+}
+
+bool PasswordHash::is_current(const string& stored, uint32_t iterations) {
+    ParsedHash h;
+    return parse_hash(stored, h) && h.iterations >= iterations;
+}
@@ -0,0 +1,38 @@
+#ifndef PASSWORD_HASH_H
+#define PASSWORD_HASH_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// ==============================
+// PASSWORD HASHING
+// ==============================
+// Salted PBKDF2-HMAC-SHA256 (RFC 8018), self-contained so the server
+// needs no crypto library. Stored form:
+//
+//   pbkdf2-sha256$<iterations>$<salt, 32 hex>$<derived key, 64 hex>
+//
+// The iteration count travels with each hash, so raising the work factor
+// (PASSWORD_HASH_ITERATIONS) only affects new hashes; older ones verify
+// as before and are re-hashed on the next successful login. Anything not
+// in this form is a legacy plain-text password.
+class PasswordHash {
+public:
+    static const uint32_t DEFAULT_ITERATIONS = 100000;
+    static const uint32_t MIN_ITERATIONS = 1000;
+
+    // PASSWORD_HASH_ITERATIONS from the environment, else the default
+    static uint32_t configured_iterations();
+
+    static std::string hash(const std::string& password, uint32_t iterations);
+    // Constant-time comparison; also accepts legacy plain-text records
+    static bool verify(const std::string& password, const std::string& stored);
+    // False for plain text or a hash made with fewer than 'iterations'
+    static bool is_current(const std::string& stored, uint32_t iterations);
+
+    static void pbkdf2_sha256(const std::string& password, const uint8_t* salt, size_t salt_len,
+                              uint32_t iterations, uint8_t* out, size_t out_len);
+};
+
+#endif
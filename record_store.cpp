@@ -0,0 +1,341 @@
+#include "record_store.h"
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <iostream>
+
+using namespace std;
+
+// Applies a partial JSON update to a typed record. The merge goes through
+// the model's own serialiser, so unknown keys are dropped and a value of
+// the wrong type rejects the whole update.
+template <class T>
+static bool merge_changes(const T& current, const json& changes, T& out) {
+    if (!changes.is_object()) return false;
+    json merged = current;
+    for (auto& el : changes.items()) merged[el.key()] = el.value();
+    try {
+        out = merged.get<T>();
+    } catch (const json::exception&) {
+        return false;
+    }
+    return true;
+}
+
+// Loads one array of the snapshot, skipping rows that don't fit the model
+template <class T>
+static vector<T> load_rows(const json& snapshot, const char* key) {
+    vector<T> rows;
+    if (!snapshot.contains(key) || !snapshot[key].is_array()) return rows;
+
+    const json& arr = snapshot[key];
+    rows.reserve(arr.size());
+    size_t skipped = 0;
+    for (const auto& el : arr) {
+        try {
+            rows.push_back(el.get<T>());
+        } catch (const json::exception&) {
+            skipped++;
+        }
+    }
+    if (skipped) cerr << "[WARN] Skipped " << skipped << " malformed " << key << " records" << endl;
+    return rows;
+}
+
+// ==========================================
+// LOOKUPS
+// ==========================================
+
+static size_t find_row(const unordered_map<string, size_t>& index, const string& key) {
+    auto it = index.find(key);
+    return it == index.end() ? RecordStore::npos : it->second;
+}
+
+size_t RecordStore::find_airport(const string& code) const { return find_row(airport_index, code); }
+size_t RecordStore::find_flight(const string& id) const { return find_row(flight_index, id); }
+size_t RecordStore::find_booking(const string& booking_id) const { return find_row(booking_index, booking_id); }
+size_t RecordStore::find_user(const string& email) const { return find_row(user_index, email); }
+
+vector<size_t> RecordStore::collect(const unordered_multimap<string, size_t>& index, const string& key) {
+    // Rows come back in hash order; sort to keep insertion order
+    vector<size_t> rows;
+    auto range = index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) rows.push_back(it->second);
+    sort(rows.begin(), rows.end());
+    return rows;
+}
+
+vector<size_t> RecordStore::bookings_by_user(const string& user_id) const { return collect(user_bookings, user_id); }
+vector<size_t> RecordStore::bookings_by_email(const string& email) const { return collect(email_bookings, email); }
+
+// ==========================================
+// AIRPORTS
+// ==========================================
+
+void RecordStore::reindex_airports() {
+    airport_index.clear();
+    for (size_t i = 0; i < airports.size(); ++i) airport_index[airports[i].code] = i;
+}
+
+bool RecordStore::add_airport(const Airport& a) {
+    if (airport_index.count(a.code)) return false;
+    airport_index[a.code] = airports.size();
+    airports.push_back(a);
+    return true;
+}
+
+bool RecordStore::delete_airport(const string& code) {
+    size_t row = find_airport(code);
+    if (row == npos) return false;
+    // A few dozen rows: erasing and reindexing is cheaper than tombstones
+    airports.erase(airports.begin() + row);
+    reindex_airports();
+    return true;
+}
+
+bool RecordStore::update_airport(const string& code, const json& changes) {
+    size_t row = find_airport(code);
+    if (row == npos) return false;
+
+    Airport next;
+    if (!merge_changes(airports[row], changes, next)) return false;
+    size_t clash = find_airport(next.code);
+    if (clash != npos && clash != row) return false;
+
+    airports[row] = next;
+    if (next.code != code) reindex_airports();
+    return true;
+}
+
+// ==========================================
+// FLIGHTS
+// ==========================================
+
+// Case-insensitive substring test; 'needle' is already folded
+static bool contains_folded(const string& haystack, const string& needle) {
+    auto it = search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+                     [](char h, char n) { return tolower((unsigned char)h) == n; });
+    return it != haystack.end();
+}
+
+static bool flight_matches(const Flight& f, const string& q) {
+    return contains_folded(f.id, q) || contains_folded(f.from_code, q) ||
+           contains_folded(f.to_code, q) || contains_folded(f.airline, q);
+}
+
+void RecordStore::index_flight_text(size_t row) {
+    const Flight& f = flights[row];
+    flight_text.add((uint32_t)row, f.id);
+    flight_text.add((uint32_t)row, f.from_code);
+    flight_text.add((uint32_t)row, f.to_code);
+    flight_text.add((uint32_t)row, f.airline);
+}
+
+vector<size_t> RecordStore::search_flights(const string& query) const {
+    vector<size_t> rows;
+    string q = TrigramIndex::fold(query);
+
+    if (q.size() < TrigramIndex::MIN_QUERY) {
+        // No trigram to look up. A one- or two-character query matches a
+        // large share of the table anyway, so a scan is output-bound.
+        for (size_t i = 0; i < flights.size(); ++i) {
+            if (flight_live[i] && (q.empty() || flight_matches(flights[i], q))) rows.push_back(i);
+        }
+        return rows;
+    }
+
+    for (uint32_t row : flight_text.candidates(q)) {
+        if (flight_live[row] && flight_matches(flights[row], q)) rows.push_back(row);
+    }
+    return rows;
+}
+
+size_t RecordStore::count_flights(const string& query) const {
+    return query.empty() ? num_live_flights : search_flights(query).size();
+}
+
+size_t RecordStore::scan_flights(const string& query, size_t from_row, size_t skip, size_t limit,
+                                 vector<size_t>& out) const {
+    string q = TrigramIndex::fold(query);
+    if (limit == 0) return from_row;
+
+    // false once the page is full
+    auto visit = [&](size_t row) {
+        if (!flight_live[row] || (!q.empty() && !flight_matches(flights[row], q))) return true;
+        if (skip > 0) { skip--; return true; }
+        out.push_back(row);
+        return out.size() < limit;
+    };
+
+    if (q.size() >= TrigramIndex::MIN_QUERY) {
+        const vector<uint32_t>* list = flight_text.shortest_list(q);
+        if (!list) return npos;
+        for (auto it = lower_bound(list->begin(), list->end(), (uint32_t)min(from_row, (size_t)UINT32_MAX));
+             it != list->end(); ++it) {
+            if (!visit(*it)) return (size_t)*it + 1;
+        }
+        return npos;
+    }
+
+    for (size_t row = from_row; row < flights.size(); ++row) {
+        if (!visit(row)) return row + 1;
+    }
+    return npos;
+}
+
+size_t RecordStore::add_flight(const Flight& f) {
+    if (flight_index.count(f.id)) return npos;
+    size_t row = flights.size();
+    flights.push_back(f);
+    flight_live.push_back(1);
+    flight_index[f.id] = row;
+    num_live_flights++;
+    flight_gen++;
+    index_flight_text(row);
+    admin_stats.flight_added(f.price);
+    return row;
+}
+
+size_t RecordStore::delete_flight(const string& id) {
+    size_t row = find_flight(id);
+    if (row == npos) return npos;
+    flight_live[row] = 0;
+    flight_index.erase(id);
+    num_live_flights--;
+    flight_gen++;
+    admin_stats.flight_removed(flights[row].price);
+    return row;
+}
+
+size_t RecordStore::update_flight(const string& id, const json& changes) {
+    size_t row = find_flight(id);
+    if (row == npos) return npos;
+
+    Flight next;
+    if (!merge_changes(flights[row], changes, next)) return npos;
+    if (next.id != id) {
+        if (flight_index.count(next.id)) return npos;
+        flight_index.erase(id);
+        flight_index[next.id] = row;
+    }
+    admin_stats.flight_removed(flights[row].price);
+    admin_stats.flight_added(next.price);
+    flights[row] = next;
+    index_flight_text(row);
+    flight_gen++;
+    return row;
+}
+
+// ==========================================
+// BOOKINGS & USERS
+// ==========================================
+
+void RecordStore::index_booking(size_t row) {
+    const Booking& b = bookings[row];
+    booking_index[b.booking_id] = row;
+    user_bookings.emplace(b.user_id, row);
+    email_bookings.emplace(b.passenger_email, row);
+    if (b.status == "confirmed") admin_stats.booking_confirmed(b);
+
+    size_t flight = find_flight(b.flight_id);
+    booking_analytics.booking_added(row, b, flight == npos ? string() : flights[flight].airline);
+}
+
+bool RecordStore::add_booking(const Booking& b) {
+    if (booking_index.count(b.booking_id)) return false;
+    bookings.push_back(b);
+    index_booking(bookings.size() - 1);
+    return true;
+}
+
+bool RecordStore::cancel_booking(const string& booking_id) {
+    size_t row = find_booking(booking_id);
+    if (row == npos) return false;
+    Booking before = bookings[row];
+    if (before.status == "confirmed") admin_stats.booking_withdrawn(before);
+    bookings[row].status = "cancelled";
+    booking_analytics.booking_changed(row, before, bookings[row]);
+    return true;
+}
+
+bool RecordStore::add_user(const User& u) {
+    if (user_index.count(u.email)) return false;
+    user_index[u.email] = users.size();
+    users.push_back(u);
+    return true;
+}
+
+bool RecordStore::set_password(const string& email, const string& expected, const string& password) {
+    size_t row = find_user(email);
+    if (row == npos || users[row].password != expected) return false;
+    users[row].password = password;
+    return true;
+}
+
+// ==========================================
+// BULK LOAD & JSON BOUNDARY
+// ==========================================
+
+uint32_t RecordStore::new_layout_tag() {
+    static random_device rd;
+    return rd();
+}
+
+void RecordStore::reindex() {
+    airport_index.clear();
+    flight_index.clear();
+    booking_index.clear();
+    user_index.clear();
+    user_bookings.clear();
+    email_bookings.clear();
+    admin_stats.clear();
+    booking_analytics.clear();
+
+    reindex_airports();
+
+    // First occurrence of a duplicated id wins, as with add_flight()
+    flight_text.clear();
+    flight_live.assign(flights.size(), 1);
+    flight_index.reserve(flights.size());
+    for (size_t i = 0; i < flights.size(); ++i) {
+        if (!flight_index.emplace(flights[i].id, i).second) {
+            flight_live[i] = 0;
+        } else {
+            index_flight_text(i);
+            admin_stats.flight_added(flights[i].price);
+        }
+    }
+    num_live_flights = flight_index.size();
+    flight_gen++;
+    tag = new_layout_tag();
+
+    booking_index.reserve(bookings.size());
+    for (size_t i = 0; i < bookings.size(); ++i) index_booking(i);
+
+    vector<User> unique_users;
+    for (auto& u : users) {
+        if (user_index.emplace(u.email, unique_users.size()).second) unique_users.push_back(move(u));
+    }
+    users.swap(unique_users);
+}
+
+void RecordStore::load(const json& snapshot) {
+    airports = load_rows<Airport>(snapshot, "airports");
+    flights = load_rows<Flight>(snapshot, "flights");
+    bookings = load_rows<Booking>(snapshot, "bookings");
+    users = load_rows<User>(snapshot, "users");
+    reindex();
+}
+
+json RecordStore::to_json() const {
+    json live = json::array();
+    for (size_t i = 0; i < flights.size(); ++i) {
+        if (flight_live[i]) live.push_back(flights[i]);
+    }
+    return {
+        {"airports", airports},
+        {"flights", move(live)},
+        {"bookings", bookings},
+        {"users", users}
+    };
+}
@@ -0,0 +1,118 @@
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+#include "Models.h"
+#include "trigram_index.h"
+#include "admin_stats.h"
+#include "booking_analytics.h"
+
+using json = nlohmann::json;
+
+// ==============================
+// TYPED RECORD STORE
+// ==============================
+// The system of record: one vector per model, rows addressed by position.
+// JSON only appears at the boundary (snapshot load/dump, WAL payloads,
+// API responses).
+//
+// Row ids are stable: flights are tombstoned on delete and bookings are
+// never removed (cancel only flips the status), so indexes can hold plain
+// positions. Tombstoned rows are dropped when the snapshot is rewritten.
+// Airports are few and simply erased.
+//
+// Not thread-safe; JsonDB guards it with db_mutex.
+class RecordStore {
+public:
+    static const size_t npos = (size_t)-1;
+
+    std::vector<Airport> airports;
+    std::vector<Flight> flights;             // row id -> flight (see flight_live)
+    std::vector<uint8_t> flight_live;        // 0 = tombstone
+    std::vector<Booking> bookings;
+    std::vector<User> users;
+
+    size_t live_flights() const { return num_live_flights; }
+    const AdminStats& stats() const { return admin_stats; }
+    const BookingAnalytics& analytics() const { return booking_analytics; }
+
+    // Bumped by every flight mutation (for derived caches such as counts)
+    uint64_t flight_generation() const { return flight_gen; }
+    // Changes whenever row ids are renumbered (bulk load), so keyset
+    // cursors from an earlier layout can be recognised
+    uint32_t layout_tag() const { return tag; }
+
+    // Lookups: row id, npos if absent
+    size_t find_airport(const std::string& code) const;
+    size_t find_flight(const std::string& id) const;
+    size_t find_booking(const std::string& booking_id) const;
+    size_t find_user(const std::string& email) const;
+
+    // Live flight rows whose id, from_code, to_code or airline contains
+    // 'query' (case-insensitive), in row order; empty query = all live rows
+    std::vector<size_t> search_flights(const std::string& query) const;
+    size_t count_flights(const std::string& query) const;
+
+    // Keyset walk over the same matches: skips 'skip' of them starting at
+    // row 'from_row', appends up to 'limit' to 'out' and returns the row to
+    // resume from (npos once the table is exhausted). Costs O(skip + limit)
+    // matches plus the non-matching rows in between.
+    size_t scan_flights(const std::string& query, size_t from_row, size_t skip, size_t limit,
+                        std::vector<size_t>& out) const;
+
+    // Booking rows for a user id / passenger email, in insertion order
+    std::vector<size_t> bookings_by_user(const std::string& user_id) const;
+    std::vector<size_t> bookings_by_email(const std::string& email) const;
+
+    // Mutations: false on duplicate key / missing record
+    bool add_airport(const Airport& a);
+    bool delete_airport(const std::string& code);
+    bool update_airport(const std::string& code, const json& changes);
+
+    size_t add_flight(const Flight& f);                                   // -> row, npos on duplicate id
+    size_t delete_flight(const std::string& id);                          // -> tombstoned row
+    size_t update_flight(const std::string& id, const json& changes);     // -> row, updated in place
+
+    bool add_booking(const Booking& b);
+    bool cancel_booking(const std::string& booking_id);
+
+    bool add_user(const User& u);
+    // Replaces the stored password only if it still equals 'expected'
+    bool set_password(const std::string& email, const std::string& expected, const std::string& password);
+
+    // JSON boundary: {"airports":[...],"flights":[...],"bookings":[...],"users":[...]}
+    void load(const json& snapshot);
+    json to_json() const;                    // live rows only
+
+    // Rebuilds every index (and marks all flights live) after the vectors
+    // were filled in bulk, e.g. by BinarySnapshot::load
+    void reindex();
+
+private:
+    size_t num_live_flights = 0;
+    uint64_t flight_gen = 0;
+    uint32_t tag = new_layout_tag();
+
+    std::unordered_map<std::string, size_t> airport_index;
+    std::unordered_map<std::string, size_t> flight_index;      // live flights only
+    std::unordered_map<std::string, size_t> booking_index;
+    std::unordered_map<std::string, size_t> user_index;        // by email
+    std::unordered_multimap<std::string, size_t> user_bookings;
+    std::unordered_multimap<std::string, size_t> email_bookings;
+    TrigramIndex flight_text;                                  // id, from_code, to_code, airline
+    AdminStats admin_stats;
+    BookingAnalytics booking_analytics;
+
+    static uint32_t new_layout_tag();
+    void reindex_airports();
+    void index_booking(size_t row);
+    void index_flight_text(size_t row);
+    static std::vector<size_t> collect(const std::unordered_multimap<std::string, size_t>& index,
+                                       const std::string& key);
+};
+
+#endif
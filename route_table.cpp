@@ -0,0 +1,311 @@
+#include "route_table.h"
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+// Larger than any real total, small enough that three of them still add up
+static const int32_t UNREACHABLE = INT32_MAX / 4;
+// Must match the layover k_shortest_routes charges per connection
+static const int32_t LAYOVER_MINUTES = 60;
+
+RouteTable::RouteTable(GraphSource source) : graph_source(move(source)) {
+    builder = thread(&RouteTable::build_loop, this);
+}
+
+RouteTable::~RouteTable() {
+    {
+        lock_guard<mutex> lock(pending_mutex);
+        stopping = true;
+    }
+    pending_cv.notify_all();
+    if (builder.joinable()) builder.join();
+}
+
+// ==========================================
+// BUILDING
+// ==========================================
+
+static bool departs_before(const Edge& e, int t) { return e.dep < t; }
+
+namespace {
+// A route while the table is assembled; sorted the way the search pops them
+struct Option {
+    int32_t total_minutes;
+    int32_t first_weight;
+    uint32_t first;
+    uint32_t second;
+    uint16_t parent_rank;
+    bool rank_exact;
+
+    bool operator<(const Option& o) const {
+        // Equal totals: the search pops older labels first. Direct flights
+        // are pushed with the source, in slice order; a one-stop is pushed
+        // when its first leg is expanded, i.e. in (first-leg weight, first
+        // leg slice position) order, then by second leg slice position.
+        bool stop = second != TableRoute::NO_LEG, o_stop = o.second != TableRoute::NO_LEG;
+        if (total_minutes != o.total_minutes) return total_minutes < o.total_minutes;
+        if (stop != o_stop) return !stop;
+        if (first_weight != o.first_weight) return first_weight < o.first_weight;
+        if (first != o.first) return first < o.first;
+        return second < o.second;
+    }
+};
+}
+
+shared_ptr<const RouteTableDay> RouteTable::build_day(const FlightGraph& g, int day) {
+    auto table = make_shared<RouteTableDay>();
+    size_t n = g.airports.size();
+    table->lineage = g.lineage;
+    table->num_airports = n;
+
+    // Every leg of the day, origin by origin; start[o] opens o's slice
+    vector<uint32_t> start(n + 1);
+    for (size_t o = 0; o < n; ++o) {
+        start[o] = (uint32_t)table->legs.size();
+        auto [first, last] = g.slice((int)o, day);
+        table->legs.insert(table->legs.end(), first, last);
+    }
+    start[n] = (uint32_t)table->legs.size();
+    const vector<Edge>& legs = table->legs;
+
+    // Lower bounds ignoring departure times: shortest direct flight per
+    // pair, then the cheapest one-stop and two-stop chains built from it
+    vector<int32_t> direct(n * n, UNREACHABLE);
+    int32_t shortest = UNREACHABLE;
+    for (size_t o = 0; o < n; ++o) {
+        for (uint32_t i = start[o]; i < start[o + 1]; ++i) {
+            int32_t& w = direct[o * n + legs[i].destination];
+            if ((size_t)legs[i].destination != o) w = min(w, legs[i].weight_minutes);
+            shortest = min(shortest, legs[i].weight_minutes);
+        }
+    }
+    vector<int32_t> one_stop(n * n, UNREACHABLE);
+    for (size_t a = 0; a < n; ++a) {
+        for (size_t y = 0; y < n; ++y) {
+            if (direct[a * n + y] >= UNREACHABLE) continue;
+            for (size_t b = 0; b < n; ++b) {
+                if (b == a || b == y || direct[y * n + b] >= UNREACHABLE) continue;
+                one_stop[a * n + b] = min(one_stop[a * n + b], direct[a * n + y] + LAYOVER_MINUTES + direct[y * n + b]);
+            }
+        }
+    }
+    // Any route with three or more stops has four legs of at least 'shortest'
+    int32_t three_stops = shortest >= UNREACHABLE ? UNREACHABLE : 4 * shortest + 3 * LAYOVER_MINUTES;
+    table->beyond.assign(n * n, three_stops);
+    for (size_t s = 0; s < n; ++s) {
+        for (size_t x = 0; x < n; ++x) {
+            if (x == s || direct[s * n + x] >= UNREACHABLE) continue;
+            for (size_t t = 0; t < n; ++t) {
+                if (t == x || one_stop[x * n + t] >= UNREACHABLE) continue;
+                table->beyond[s * n + t] = min(table->beyond[s * n + t],
+                                               direct[s * n + x] + LAYOVER_MINUTES + one_stop[x * n + t]);
+            }
+        }
+    }
+
+    table->offsets.assign(n * n + 1, 0);
+    table->truncated.assign(n * n, 0);
+    vector<vector<Option>> by_target(n);
+    vector<uint16_t> rank;
+    vector<uint32_t> order;
+
+    for (size_t s = 0; s < n; ++s) {
+        for (auto& options : by_target) options.clear();
+
+        // Expansion rank of each direct flight at its destination: the
+        // search expands at most k labels per airport, cheapest first
+        order.clear();
+        for (uint32_t i = start[s]; i < start[s + 1]; ++i) {
+            if ((size_t)legs[i].destination != s) order.push_back(i);
+        }
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            const Edge& x = legs[a];
+            const Edge& y = legs[b];
+            if (x.destination != y.destination) return x.destination < y.destination;
+            if (x.weight_minutes != y.weight_minutes) return x.weight_minutes < y.weight_minutes;
+            return a < b;
+        });
+        rank.assign(start[s + 1] - start[s], 0);
+        for (size_t j = 1; j < order.size(); ++j) {
+            if (legs[order[j]].destination == legs[order[j - 1]].destination) {
+                rank[order[j] - start[s]] = rank[order[j - 1] - start[s]] + 1;
+            }
+        }
+
+        for (uint32_t i = start[s]; i < start[s + 1]; ++i) {
+            const Edge& e1 = legs[i];
+            size_t m = e1.destination;
+            if (m == s) continue;
+            by_target[m].push_back({e1.weight_minutes, e1.weight_minutes, i, TableRoute::NO_LEG, 0, true});
+
+            uint16_t r = rank[i - start[s]];
+            if (r >= DEPTH) continue;  // never expanded for any k the table serves
+            // A multi-leg label into m that is cheaper would be expanded first
+            bool exact = e1.weight_minutes <= min(one_stop[s * n + m], table->beyond[s * n + m]);
+
+            const Edge* base = legs.data();
+            const Edge* second = lower_bound(base + start[m], base + start[m + 1], e1.arr, departs_before);
+            for (; second != base + start[m + 1]; ++second) {
+                size_t v = second->destination;
+                if (v == s || v == m) continue;
+                by_target[v].push_back({e1.weight_minutes + second->weight_minutes + LAYOVER_MINUTES,
+                                        e1.weight_minutes, i, (uint32_t)(second - base), r, exact});
+            }
+        }
+
+        for (size_t t = 0; t < n; ++t) {
+            size_t p = s * n + t;
+            vector<Option>& options = by_target[t];
+            size_t keep = min(options.size(), (size_t)DEPTH);
+            partial_sort(options.begin(), options.begin() + keep, options.end());
+            for (size_t j = 0; j < keep; ++j) {
+                const Option& o = options[j];
+                table->routes.push_back({o.total_minutes, o.first, o.second, o.parent_rank, o.rank_exact});
+            }
+            table->truncated[p] = options.size() > keep;
+            table->offsets[p + 1] = (uint32_t)table->routes.size();
+        }
+    }
+    return table;
+}
+
+void RouteTable::build_loop() {
+    unique_lock<mutex> lock(pending_mutex);
+    while (true) {
+        pending_cv.wait(lock, [&] { return stopping || !pending.empty(); });
+        if (stopping) return;
+        int day = *pending.begin();
+        pending.erase(pending.begin());
+        lock.unlock();
+
+        // Versions are read before the graph: if the day is invalidated
+        // meanwhile, this build is discarded (and already rescheduled)
+        uint64_t gen, version;
+        {
+            shared_lock<shared_mutex> table_lock(table_mutex);
+            gen = generation;
+            auto it = day_versions.find(day);
+            version = it == day_versions.end() ? 0 : it->second;
+        }
+        shared_ptr<const FlightGraph> g = graph_source();
+        if (g) {
+            shared_ptr<const RouteTableDay> table = build_day(*g, day);
+            unique_lock<shared_mutex> table_lock(table_mutex);
+            if (gen == generation && day_versions[day] == version) {
+                days[day] = move(table);
+                builds++;
+            }
+        }
+        lock.lock();
+    }
+}
+
+void RouteTable::schedule(int day) {
+    {
+        lock_guard<mutex> lock(pending_mutex);
+        pending.insert(day);
+    }
+    pending_cv.notify_one();
+}
+
+void RouteTable::rebuild_all() {
+    {
+        unique_lock<shared_mutex> lock(table_mutex);
+        generation++;
+        days.clear();
+        day_versions.clear();
+    }
+    shared_ptr<const FlightGraph> g = graph_source();
+    if (!g) return;
+    {
+        lock_guard<mutex> lock(pending_mutex);
+        for (int d = g->first_day; d < g->first_day + g->num_days; ++d) pending.insert(d);
+    }
+    pending_cv.notify_one();
+}
+
+void RouteTable::invalidate_day(int day) {
+    {
+        unique_lock<shared_mutex> lock(table_mutex);
+        day_versions[day]++;
+        days.erase(day);
+    }
+    schedule(day);
+}
+
+// ==========================================
+// LOOKUP
+// ==========================================
+
+shared_ptr<const RouteTableDay> RouteTable::lookup(const FlightGraph& g, int s, int t, int day, int k,
+                                                   vector<const TableRoute*>& out) {
+    out.clear();
+    shared_ptr<const RouteTableDay> table;
+    if (k >= 1 && k <= DEPTH) {
+        shared_lock<shared_mutex> lock(table_mutex);
+        auto it = days.find(day);
+        if (it != days.end()) table = it->second;
+    }
+    if (!table || table->lineage != g.lineage || s == t || s < 0 || t < 0 ||
+        (size_t)max(s, t) >= table->num_airports) {
+        fallbacks++;
+        return nullptr;
+    }
+
+    size_t p = (size_t)s * table->num_airports + t;
+    int32_t beyond = table->beyond[p];
+    bool answered = true;
+    for (uint32_t i = table->offsets[p]; i < table->offsets[p + 1] && (int)out.size() < k; ++i) {
+        const TableRoute& r = table->routes[i];
+        bool one_stop = r.second != TableRoute::NO_LEG;
+        if (one_stop && r.parent_rank >= k) continue;  // its first leg is never expanded
+
+        // A route with more stops might come first; on a tie a direct
+        // flight still wins, being the older label
+        bool longer_first = one_stop ? r.total_minutes >= beyond : r.total_minutes > beyond;
+        if (longer_first || (one_stop && !r.rank_exact)) {
+            answered = false;
+            break;
+        }
+        out.push_back(&r);
+    }
+    // Fewer than k: only final if nothing was cut off and no longer route exists
+    if (answered && (int)out.size() < k && (table->truncated[p] || beyond < UNREACHABLE)) answered = false;
+
+    // Interned indexes must exist in the caller's graph (same lineage, maybe older)
+    for (size_t j = 0; answered && j < out.size(); ++j) {
+        for (uint32_t leg : {out[j]->first, out[j]->second}) {
+            if (leg == TableRoute::NO_LEG) continue;
+            const Edge& e = table->legs[leg];
+            if ((size_t)e.flight >= g.flights.size() || (size_t)e.destination >= g.airports.size()) answered = false;
+        }
+    }
+
+    if (!answered) {
+        out.clear();
+        fallbacks++;
+        return nullptr;
+    }
+    hits++;
+    return table;
+}
+
+json RouteTable::stats() {
+    size_t num_days, num_pending;
+    {
+        shared_lock<shared_mutex> lock(table_mutex);
+        num_days = days.size();
+    }
+    {
+        lock_guard<mutex> lock(pending_mutex);
+        num_pending = pending.size();
+    }
+    return {
+        {"days", num_days},
+        {"pending", num_pending},
+        {"hits", hits.load()},
+        {"fallbacks", fallbacks.load()},
+        {"builds", builds.load()}
+    };
+}
@@ -0,0 +1,106 @@
+#ifndef ROUTE_TABLE_H
+#define ROUTE_TABLE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <set>
+#include <unordered_map>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "flight_graph.h"
+
+using json = nlohmann::json;
+
+// One precomputed option: a direct flight or a one-stop (second == NO_LEG)
+struct TableRoute {
+    static const uint32_t NO_LEG = UINT32_MAX;
+
+    int32_t total_minutes;   // as the smart search counts it (60-minute layover)
+    uint32_t first;          // index into RouteTableDay::legs
+    uint32_t second;
+    uint16_t parent_rank;    // one-stop: direct flights into the stop expanded before this one
+    bool rank_exact;         // no multi-leg path can reach the stop before the first leg does
+};
+
+// The table for one departure day, built from one graph snapshot
+struct RouteTableDay {
+    uint64_t lineage;                  // FlightGraph::lineage it was built from
+    size_t num_airports;
+    std::vector<Edge> legs;            // copies of every edge leaving on this day
+    std::vector<uint32_t> offsets;     // pair (s * n + t) -> routes[offsets[p] .. offsets[p + 1])
+    std::vector<TableRoute> routes;    // per pair, in the order the smart search returns them
+    std::vector<int32_t> beyond;       // per pair: lower bound on any route with >= 2 stops
+    std::vector<uint8_t> truncated;    // per pair: options past DEPTH were dropped
+};
+
+// ==============================
+// DIRECT / ONE-STOP ROUTE TABLE
+// ==============================
+// For every departure day and every airport pair, the best direct and
+// one-stop options, ranked exactly as the k-shortest smart search ranks
+// them (including its per-airport expansion limit and tie order). Days are
+// built on a background thread and rebuilt one at a time when a flight
+// mutation touches them; until then lookups for that day miss.
+//
+// A lookup only answers when the table provably gives the search's
+// result: k <= DEPTH, every returned option beats the lower bound on
+// routes with two or more stops, and no option depends on an expansion
+// count the table cannot know. Everything else falls back to the search.
+class RouteTable {
+public:
+    static const int DEPTH = 8;
+
+    using GraphSource = std::function<std::shared_ptr<const FlightGraph>()>;
+
+    explicit RouteTable(GraphSource source);
+    ~RouteTable();
+
+    RouteTable(const RouteTable&) = delete;
+    RouteTable& operator=(const RouteTable&) = delete;
+
+    // The graph was replaced wholesale: drop everything, rebuild every day
+    void rebuild_all();
+    // Flights departing on 'day' changed. Call after publishing the graph
+    // and before invalidating anything cached from this table's answers.
+    void invalidate_day(int day);
+
+    // The k best options s -> t on 'day', or null if the table cannot
+    // answer; 'out' points into the returned day, which keeps it alive
+    std::shared_ptr<const RouteTableDay> lookup(const FlightGraph& g, int s, int t, int day, int k,
+                                                std::vector<const TableRoute*>& out);
+
+    // Builds one day synchronously (also what the background thread runs)
+    static std::shared_ptr<const RouteTableDay> build_day(const FlightGraph& g, int day);
+
+    json stats();
+
+private:
+    GraphSource graph_source;
+
+    mutable std::shared_mutex table_mutex;
+    std::unordered_map<int, std::shared_ptr<const RouteTableDay>> days;
+    std::unordered_map<int, uint64_t> day_versions;  // bumped by invalidate_day
+    uint64_t generation = 0;                         // bumped by rebuild_all
+
+    std::thread builder;
+    std::mutex pending_mutex;
+    std::condition_variable pending_cv;
+    std::set<int> pending;
+    bool stopping = false;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> fallbacks{0};
+    std::atomic<uint64_t> builds{0};
+
+    void build_loop();
+    void schedule(int day);
+};
+
+#endif
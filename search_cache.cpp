@@ -0,0 +1,98 @@
+#include "search_cache.h"
+#include <functional>
+
+using namespace std;
+
+SearchCache::SearchCache(size_t capacity, size_t num_shards)
+    : shards(num_shards), shard_capacity(max<size_t>(1, capacity / num_shards)) {}
+
+SearchCache::Shard& SearchCache::shard_for(const string& key) {
+    return shards[hash<string>()(key) % shards.size()];
+}
+
+bool SearchCache::get(const string& key, string& body) {
+    Shard& sh = shard_for(key);
+    lock_guard<mutex> lock(sh.mutex);
+
+    auto it = sh.index.find(key);
+    if (it == sh.index.end()) {
+        misses++;
+        return false;
+    }
+    sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+    body = it->second->body;
+    hits++;
+    return true;
+}
+
+void SearchCache::put(const string& key, int first_day, int last_day, uint64_t epoch, string body) {
+    Shard& sh = shard_for(key);
+    lock_guard<mutex> lock(sh.mutex);
+
+    // Computed on a graph that has since changed: don't cache it
+    if (epoch != current_epoch.load(memory_order_acquire)) return;
+
+    auto it = sh.index.find(key);
+    if (it != sh.index.end()) {
+        it->second->body = move(body);
+        sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+        return;
+    }
+
+    sh.lru.push_front({key, move(body), first_day, last_day});
+    sh.index[key] = sh.lru.begin();
+
+    if (sh.lru.size() > shard_capacity) {
+        sh.index.erase(sh.lru.back().key);
+        sh.lru.pop_back();
+        evictions++;
+    }
+}
+
+void SearchCache::invalidate_day(int day) {
+    // Bump first: a put racing with this sweep is either swept or rejected
+    current_epoch.fetch_add(1, memory_order_acq_rel);
+
+    for (auto& sh : shards) {
+        lock_guard<mutex> lock(sh.mutex);
+        for (auto it = sh.lru.begin(); it != sh.lru.end();) {
+            if (it->first_day <= day && day <= it->last_day) {
+                sh.index.erase(it->key);
+                it = sh.lru.erase(it);
+                invalidations++;
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void SearchCache::clear() {
+    current_epoch.fetch_add(1, memory_order_acq_rel);
+
+    for (auto& sh : shards) {
+        lock_guard<mutex> lock(sh.mutex);
+        invalidations += sh.lru.size();
+        sh.lru.clear();
+        sh.index.clear();
+    }
+}
+
+json SearchCache::stats() {
+    size_t entries = 0;
+    for (auto& sh : shards) {
+        lock_guard<mutex> lock(sh.mutex);
+        entries += sh.lru.size();
+    }
+
+    uint64_t h = hits, m = misses;
+    return {
+        {"entries", entries},
+        {"capacity", shard_capacity * shards.size()},
+        {"hits", h},
+        {"misses", m},
+        {"hit_rate", h + m ? (double)h / (h + m) : 0.0},
+        {"evictions", evictions.load()},
+        {"invalidations", invalidations.load()}
+    };
+}
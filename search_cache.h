@@ -0,0 +1,64 @@
+#ifndef SEARCH_CACHE_H
+#define SEARCH_CACHE_H
+
+#include <string>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// ==============================
+// SEARCH RESULT CACHE
+// ==============================
+// Sharded LRU of pre-serialised search response bodies. Every entry
+// records the range of days its search could read; a flight mutation on
+// day D drops exactly the entries whose range contains D.
+//
+// Stale-fill protection: callers read epoch() *before* loading the graph
+// snapshot and pass it to put(); any invalidation in between bumps the
+// epoch and the put is discarded.
+class SearchCache {
+private:
+    struct Entry {
+        std::string key;
+        std::string body;
+        int first_day;
+        int last_day;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;   // front = most recently used
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    std::vector<Shard> shards;
+    size_t shard_capacity;
+
+    std::atomic<uint64_t> current_epoch{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> invalidations{0};
+
+    Shard& shard_for(const std::string& key);
+
+public:
+    explicit SearchCache(size_t capacity = 4096, size_t num_shards = 16);
+
+    bool get(const std::string& key, std::string& body);
+    void put(const std::string& key, int first_day, int last_day, uint64_t epoch, std::string body);
+
+    uint64_t epoch() const { return current_epoch.load(std::memory_order_acquire); }
+    void invalidate_day(int day);
+    void clear();
+
+    json stats();
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "session_store.h"
+#include <algorithm>
+#include <random>
+
+using namespace std;
+
+SessionStore::SessionStore(chrono::seconds ttl, size_t num_shards, chrono::seconds sweep_interval)
+    : shards(max<size_t>(1, num_shards)), session_ttl(ttl), sweep_every(sweep_interval) {
+    sweeper = thread(&SessionStore::sweep_loop, this);
+}
+
+SessionStore::~SessionStore() {
+    {
+        lock_guard<mutex> lock(sweep_mutex);
+        stopping = true;
+    }
+    sweep_cv.notify_all();
+    if (sweeper.joinable()) sweeper.join();
+}
+
+SessionStore::Shard& SessionStore::shard_for(const string& token) {
+    return shards[hash<string>{}(token) % shards.size()];
+}
+
+const SessionStore::Shard& SessionStore::shard_for(const string& token) const {
+    return shards[hash<string>{}(token) % shards.size()];
+}
+
+string SessionStore::new_token() {
+    // random_device is the OS entropy source; tokens must not be guessable
+    static thread_local random_device rd;
+    static const char digits[] = "0123456789abcdef";
+    string token(64, '0');
+    for (size_t i = 0; i < token.size(); i += 8) {
+        uint32_t r = rd();
+        for (size_t j = 0; j < 8; ++j, r >>= 4) token[i + j] = digits[r & 15];
+    }
+    return token;
+}
+
+// ==========================================
+// TOKENS
+// ==========================================
+
+string SessionStore::create(const string& user_id, const string& email, const string& name) {
+    Session s{user_id, email, name, chrono::steady_clock::now() + session_ttl};
+    while (true) {
+        string token = new_token();
+        Shard& sh = shard_for(token);
+        unique_lock<shared_mutex> lock(sh.mutex);
+        if (sh.sessions.emplace(token, s).second) return token;
+    }
+}
+
+bool SessionStore::find(const string& token, Session& out) const {
+    const Shard& sh = shard_for(token);
+    shared_lock<shared_mutex> lock(sh.mutex);
+    auto it = sh.sessions.find(token);
+    if (it == sh.sessions.end() || it->second.expires <= chrono::steady_clock::now()) return false;
+    out = it->second;
+    return true;
+}
+
+bool SessionStore::revoke(const string& token) {
+    Shard& sh = shard_for(token);
+    unique_lock<shared_mutex> lock(sh.mutex);
+    return sh.sessions.erase(token) > 0;
+}
+
+size_t SessionStore::size() const {
+    size_t n = 0;
+    for (const auto& sh : shards) {
+        shared_lock<shared_mutex> lock(sh.mutex);
+        n += sh.sessions.size();
+    }
+    return n;
+}
+
+// ==========================================
+// EXPIRY
+// ==========================================
+
+size_t SessionStore::sweep() {
+    auto now = chrono::steady_clock::now();
+    size_t removed = 0;
+    // One shard at a time, so lookups elsewhere carry on
+    for (auto& sh : shards) {
+        unique_lock<shared_mutex> lock(sh.mutex);
+        for (auto it = sh.sessions.begin(); it != sh.sessions.end();) {
+            if (it->second.expires <= now) {
+                it = sh.sessions.erase(it);
+                removed++;
+            } else {
+                ++it;
+            }
+        }
+    }
+    return removed;
+}
+
+void SessionStore::sweep_loop() {
+    unique_lock<mutex> lock(sweep_mutex);
+    while (!stopping) {
+        sweep_cv.wait_for(lock, sweep_every);
+        if (stopping) break;
+        lock.unlock();
+        sweep();
+        lock.lock();
+    }
+}
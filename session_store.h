@@ -0,0 +1,72 @@
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+
+// What a token stands for, copied at login so that checking a token
+// never has to consult the user store
+struct Session {
+    std::string user_id;
+    std::string email;
+    std::string name;
+    std::chrono::steady_clock::time_point expires;
+};
+
+// ==============================
+// SESSION STORE
+// ==============================
+// Opaque bearer tokens (256 random bits, hex) mapped to their session in
+// a sharded in-memory table. A lookup is one hash probe under a shared
+// shard lock; expired entries are ignored on lookup and removed by a
+// background sweeper, so the read path never writes.
+//
+// Sessions are not persisted: a restart logs everyone out.
+class SessionStore {
+public:
+    explicit SessionStore(std::chrono::seconds ttl, size_t num_shards = 16,
+                          std::chrono::seconds sweep_interval = std::chrono::seconds(60));
+    ~SessionStore();
+
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    std::chrono::seconds ttl() const { return session_ttl; }
+
+    // New token for a freshly authenticated user
+    std::string create(const std::string& user_id, const std::string& email, const std::string& name);
+    // False if the token is unknown or expired
+    bool find(const std::string& token, Session& out) const;
+    bool revoke(const std::string& token);
+
+    size_t sweep();    // -> sessions removed
+    size_t size() const;
+
+private:
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, Session> sessions;
+    };
+
+    std::vector<Shard> shards;
+    std::chrono::seconds session_ttl;
+
+    std::chrono::seconds sweep_every;
+    std::thread sweeper;
+    std::mutex sweep_mutex;
+    std::condition_variable sweep_cv;
+    bool stopping = false;
+
+    Shard& shard_for(const std::string& token);
+    const Shard& shard_for(const std::string& token) const;
+    void sweep_loop();
+    static std::string new_token();
+};
+
+#endif
@@ -0,0 +1,313 @@
+#include "snapshot.h"
+#include "fnv.h"
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char SNAPSHOT_MAGIC[8] = {'F', 'L', 'T', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+// ==========================================
+// ENCODING
+// ==========================================
+
+struct SnapshotWriter {
+    string out;
+
+    template <class T> void pod(const T& v) {
+        static_assert(is_trivially_copyable<T>::value, "raw copy only");
+        out.append((const char*)&v, sizeof(T));
+    }
+    void str(const string& s) {
+        pod((uint32_t)s.size());
+        out += s;
+    }
+    template <class T> void array(const vector<T>& v) {
+        static_assert(is_trivially_copyable<T>::value, "raw copy only");
+        pod((uint64_t)v.size());
+        out.append((const char*)v.data(), v.size() * sizeof(T));
+    }
+};
+
+// Bounds-checked cursor over the mapped file; any overrun clears 'ok'
+struct SnapshotReader {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    template <class T> T pod() {
+        T v{};
+        if ((size_t)(end - p) < sizeof(T)) { ok = false; return v; }
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    string str() {
+        uint32_t n = pod<uint32_t>();
+        if (!ok || (size_t)(end - p) < n) { ok = false; return string(); }
+        string s(p, n);
+        p += n;
+        return s;
+    }
+    template <class T> void array(vector<T>& v) {
+        uint64_t n = pod<uint64_t>();
+        if (!ok || n > (size_t)(end - p) / sizeof(T)) { ok = false; return; }
+        v.resize(n);
+        memcpy(v.data(), p, n * sizeof(T));
+        p += n * sizeof(T);
+    }
+    // Element counts are checked against the bytes left before reserving
+    size_t count(size_t min_record_size) {
+        uint64_t n = pod<uint64_t>();
+        if (!ok || n > (size_t)(end - p) / min_record_size) { ok = false; return 0; }
+        return (size_t)n;
+    }
+};
+
+static void put(SnapshotWriter& w, const Airport& a) {
+    w.pod((int32_t)a.id);
+    w.str(a.code); w.str(a.name); w.str(a.city);
+    w.pod(a.lat); w.pod(a.lng);
+}
+
+static void get(SnapshotReader& r, Airport& a) {
+    a.id = r.pod<int32_t>();
+    a.code = r.str(); a.name = r.str(); a.city = r.str();
+    a.lat = r.pod<double>(); a.lng = r.pod<double>();
+}
+
+static void put(SnapshotWriter& w, const Flight& f) {
+    w.str(f.id); w.str(f.airline); w.str(f.from_code); w.str(f.to_code);
+    w.str(f.date); w.str(f.departure); w.str(f.arrival); w.str(f.duration);
+    w.pod((int32_t)f.price);
+}
+
+static void get(SnapshotReader& r, Flight& f) {
+    f.id = r.str(); f.airline = r.str(); f.from_code = r.str(); f.to_code = r.str();
+    f.date = r.str(); f.departure = r.str(); f.arrival = r.str(); f.duration = r.str();
+    f.price = r.pod<int32_t>();
+}
+
+static void put(SnapshotWriter& w, const Booking& b) {
+    w.str(b.booking_id); w.str(b.user_id); w.str(b.flight_id);
+    w.str(b.passenger_name); w.str(b.passenger_email);
+    w.str(b.from_code); w.str(b.to_code); w.str(b.date);
+    w.pod((int32_t)b.total_price);
+    w.str(b.booking_date); w.str(b.status);
+}
+
+static void get(SnapshotReader& r, Booking& b) {
+    b.booking_id = r.str(); b.user_id = r.str(); b.flight_id = r.str();
+    b.passenger_name = r.str(); b.passenger_email = r.str();
+    b.from_code = r.str(); b.to_code = r.str(); b.date = r.str();
+    b.total_price = r.pod<int32_t>();
+    b.booking_date = r.str(); b.status = r.str();
+}
+
+static void put(SnapshotWriter& w, const User& u) {
+    w.str(u.id); w.str(u.name); w.str(u.email); w.str(u.password); w.str(u.created_at);
+}
+
+static void get(SnapshotReader& r, User& u) {
+    u.id = r.str(); u.name = r.str(); u.email = r.str(); u.password = r.str(); u.created_at = r.str();
+}
+
+template <class T>
+static void put_rows(SnapshotWriter& w, const vector<T>& rows) {
+    w.pod((uint64_t)rows.size());
+    for (const auto& row : rows) put(w, row);
+}
+
+template <class T>
+static void get_rows(SnapshotReader& r, vector<T>& rows) {
+    // Every record has at least one u32 length prefix
+    size_t n = r.count(sizeof(uint32_t));
+    rows.resize(n);
+    for (size_t i = 0; i < n && r.ok; ++i) get(r, rows[i]);
+}
+
+template <typename Strings>
+static void put_strings(SnapshotWriter& w, const Strings& v) {
+    w.pod((uint64_t)v.size());
+    for (size_t i = 0; i < v.size(); ++i) w.str(v[i]);
+}
+
+static void get_strings(SnapshotReader& r, vector<string>& v) {
+    size_t n = r.count(sizeof(uint32_t));
+    v.resize(n);
+    for (size_t i = 0; i < n && r.ok; ++i) v[i] = r.str();
+}
+
+// ==========================================
+// FILE ACCESS
+// ==========================================
+
+// Read-only view of a whole file: mmap where available, a plain read otherwise
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+#ifdef _WIN32
+        ifstream in(path, ios::binary);
+        if (!in.is_open()) return;
+        buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        ptr = buffer.data();
+        len = buffer.size();
+        valid = true;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+                ptr = (const char*)addr;
+                len = (size_t)st.st_size;
+                valid = true;
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (valid) munmap((void*)ptr, len);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const { return valid; }
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const char* ptr = nullptr;
+    size_t len = 0;
+    bool valid = false;
+#ifdef _WIN32
+    string buffer;
+#endif
+};
+
+// ==========================================
+// WRITE / LOAD
+// ==========================================
+
+string BinarySnapshot::encode(const RecordStore& store, const FlightGraph& graph, uint64_t wal_seq) {
+    SnapshotWriter w;
+    w.out.reserve(64 + store.flights.size() * 96 + graph.edges.size() * (sizeof(Edge) + sizeof(Connection)));
+    w.out.resize(sizeof(SnapshotHeader));
+
+    // Records section
+    put_rows(w, store.airports);
+    w.pod((uint64_t)store.live_flights());
+    for (size_t i = 0; i < store.flights.size(); ++i) {
+        if (store.flight_live[i]) put(w, store.flights[i]);
+    }
+    put_rows(w, store.bookings);
+    put_rows(w, store.users);
+
+    // Graph section
+    put_strings(w, graph.airports);
+    put_strings(w, graph.airlines);
+    w.pod((uint64_t)graph.flights.size());
+    for (size_t i = 0; i < graph.flights.size(); ++i) {
+        const FlightInfo& f = graph.flights[i];
+        w.str(f.id);
+        w.pod(f.airline);
+        w.pod(f.origin);
+    }
+    w.pod((int32_t)graph.first_day);
+    w.pod((int32_t)graph.num_days);
+    w.array(graph.offsets);
+    w.array(graph.edges);
+    w.array(graph.connections);
+
+    SnapshotHeader h;
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = VERSION;
+    h.byte_order = SNAPSHOT_BYTE_ORDER;
+    h.wal_seq = wal_seq;
+    h.payload_size = w.out.size() - sizeof(SnapshotHeader);
+    h.checksum = fnv1a64(w.out.data() + sizeof(SnapshotHeader), h.payload_size);
+    memcpy(&w.out[0], &h, sizeof(h));
+    return move(w.out);
+}
+
+bool BinarySnapshot::load(const string& path, RecordStore& store, FlightGraph& graph, uint64_t& wal_seq) {
+    MappedFile file(path);
+    if (!file.ok()) return false;
+
+    SnapshotHeader h;
+    if (file.size() < sizeof(h)) {
+        cerr << "[SNAPSHOT] " << path << " is truncated" << endl;
+        return false;
+    }
+    memcpy(&h, file.data(), sizeof(h));
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0 || h.byte_order != SNAPSHOT_BYTE_ORDER) {
+        cerr << "[SNAPSHOT] " << path << " is not a snapshot for this platform" << endl;
+        return false;
+    }
+    if (h.version != VERSION) {
+        cerr << "[SNAPSHOT] " << path << " has version " << h.version << ", expected " << VERSION << endl;
+        return false;
+    }
+    const char* payload = file.data() + sizeof(h);
+    if (h.payload_size != file.size() - sizeof(h) || fnv1a64(payload, h.payload_size) != h.checksum) {
+        cerr << "[SNAPSHOT] " << path << " failed its checksum" << endl;
+        return false;
+    }
+
+    SnapshotReader r{payload, payload + h.payload_size};
+    RecordStore s;
+    get_rows(r, s.airports);
+    get_rows(r, s.flights);
+    get_rows(r, s.bookings);
+    get_rows(r, s.users);
+
+    FlightGraph g;
+    vector<string> airports, airlines;
+    get_strings(r, airports);
+    get_strings(r, airlines);
+    size_t num_flights = r.count(sizeof(uint32_t) + 2 * sizeof(int32_t));
+    vector<FlightInfo> flights(num_flights);
+    for (size_t i = 0; i < num_flights && r.ok; ++i) {
+        flights[i].id = r.str();
+        flights[i].airline = r.pod<int32_t>();
+        flights[i].origin = r.pod<int32_t>();
+    }
+    g.restore_names(airports, airlines, flights);
+    g.first_day = r.pod<int32_t>();
+    g.num_days = r.pod<int32_t>();
+    r.array(g.offsets);
+    r.array(g.edges);
+    r.array(g.connections);
+
+    bool shape_ok = g.offsets.size() == (g.airports.empty() ? 0 : g.airports.size() * g.num_days + 1) &&
+                    (g.offsets.empty() || g.offsets.back() == g.edges.size()) &&
+                    g.connections.size() == g.edges.size();
+    if (!r.ok || r.p != r.end || !shape_ok) {
+        cerr << "[SNAPSHOT] " << path << " has a malformed payload" << endl;
+        return false;
+    }
+
+    s.reindex();
+    store = move(s);
+    graph = move(g);
+    wal_seq = h.wal_seq;
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <cstdint>
+#include "record_store.h"
+#include "flight_graph.h"
+
+// ==============================
+// BINARY SNAPSHOT
+// ==============================
+// Versioned, checksummed image of the record store plus the ready-built
+// flight graph, so startup is an mmap + copy instead of a JSON parse and
+// a graph build.
+//
+//   SnapshotHeader
+//   records section   airports, flights, bookings, users
+//                     (u32 counts, strings as u32 length + bytes)
+//   graph section     FlightGraph arrays; edges/connections/offsets raw
+//
+// header.checksum is FNV-1a 64 (word-wise) over everything after the header. Integers
+// are stored in native byte order; 'byte_order' rejects a foreign file.
+// Only live flights are written, so tombstones disappear here.
+struct SnapshotHeader {
+    char magic[8];            // "FLTSNAP\0"
+    uint32_t version;
+    uint32_t byte_order;      // SNAPSHOT_BYTE_ORDER as written by this host
+    uint64_t wal_seq;         // last WAL record contained in the image
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+class BinarySnapshot {
+public:
+    static const uint32_t VERSION = 1;
+
+    // The complete file image; written with WriteAheadLog::write_atomically
+    static std::string encode(const RecordStore& store, const FlightGraph& graph, uint64_t wal_seq);
+
+    // False if missing, truncated, corrupt or of another version;
+    // 'store' and 'graph' are only replaced on success.
+    static bool load(const std::string& path, RecordStore& store,
+                     FlightGraph& graph, uint64_t& wal_seq);
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t threads, size_t max_queue_) : max_queue(max_queue_) {
+    threads = max<size_t>(1, threads);
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) workers.emplace_back(&ThreadPool::worker_loop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cv.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+bool ThreadPool::enqueue(function<void()> job) {
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        if (stopping || queue.size() >= max_queue) return false;
+        queue.push_back(move(job));
+    }
+    queue_cv.notify_one();
+    return true;
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        function<void()> job;
+        {
+            unique_lock<mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [&] { return !queue.empty() || stopping; });
+            // Queued work is finished before shutting down
+            if (queue.empty()) return;
+            job = move(queue.front());
+            queue.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <future>
+#include <memory>
+
+// ==============================
+// BOUNDED THREAD POOL
+// ==============================
+// Fixed set of workers draining a FIFO queue of at most 'max_queue'
+// waiting tasks. submit() never blocks: when the queue is full the
+// returned future is invalid (!valid()), so callers can shed load
+// instead of piling up behind a burst of expensive requests.
+class ThreadPool {
+public:
+    ThreadPool(size_t threads, size_t max_queue);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    template <class F>
+    auto submit(F&& f) -> std::future<decltype(f())> {
+        using R = decltype(f());
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        if (!enqueue([task] { (*task)(); })) return std::future<R>();
+        return task->get_future();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    size_t max_queue;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    bool stopping = false;
+
+    bool enqueue(std::function<void()> job);
+    void worker_loop();
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include "trigram_index.h"
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+string TrigramIndex::fold(const string& s) {
+    string out(s);
+    for (char& c : out) c = (char)tolower((unsigned char)c);
+    return out;
+}
+
+void TrigramIndex::add(uint32_t row, const string& text) {
+    if (text.size() < 3) return;
+    string folded = fold(text);
+
+    for (size_t i = 0; i + 3 <= folded.size(); ++i) {
+        vector<uint32_t>& list = postings[key(folded.data() + i)];
+        // Rows normally arrive in ascending order (appends); an updated
+        // row is inserted in place instead
+        if (list.empty() || list.back() < row) {
+            list.push_back(row);
+        } else {
+            auto pos = lower_bound(list.begin(), list.end(), row);
+            if (pos == list.end() || *pos != row) list.insert(pos, row);
+        }
+    }
+}
+
+vector<uint32_t> TrigramIndex::candidates(const string& q) const {
+    vector<const vector<uint32_t>*> lists;
+    for (size_t i = 0; i + 3 <= q.size(); ++i) {
+        auto it = postings.find(key(q.data() + i));
+        if (it == postings.end()) return {};
+        lists.push_back(&it->second);
+    }
+    if (lists.empty()) return {};
+
+    // Intersect starting from the shortest list (repeated trigrams end up adjacent)
+    sort(lists.begin(), lists.end(), [](const vector<uint32_t>* a, const vector<uint32_t>* b) {
+        return a->size() != b->size() ? a->size() < b->size() : a < b;
+    });
+    lists.erase(unique(lists.begin(), lists.end()), lists.end());
+
+    vector<uint32_t> result(*lists[0]), next;
+    for (size_t l = 1; l < lists.size() && !result.empty(); ++l) {
+        next.clear();
+        set_intersection(result.begin(), result.end(), lists[l]->begin(), lists[l]->end(), back_inserter(next));
+        result.swap(next);
+    }
+    return result;
+}
+
+const vector<uint32_t>* TrigramIndex::shortest_list(const string& q) const {
+    const vector<uint32_t>* best = nullptr;
+    for (size_t i = 0; i + 3 <= q.size(); ++i) {
+        auto it = postings.find(key(q.data() + i));
+        if (it == postings.end()) return nullptr;
+        if (!best || it->second.size() < best->size()) best = &it->second;
+    }
+    return best;
+}
@@ -0,0 +1,46 @@
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+// ==============================
+// TRIGRAM INDEX
+// ==============================
+// Case-folded substring index: every 3-character window of an indexed
+// string maps to the sorted list of rows containing it. A query of three
+// or more characters is answered by intersecting the lists of its own
+// trigrams, which yields a superset of the matching rows (the trigrams may
+// sit in different fields or positions); the caller verifies each one.
+//
+// Removal is lazy: deleted or rewritten rows stay in their old lists and
+// are filtered out by that verification. The index is rebuilt whenever
+// the store is loaded, so stale entries don't accumulate across restarts.
+class TrigramIndex {
+public:
+    static const size_t MIN_QUERY = 3;
+
+    static std::string fold(const std::string& s);
+
+    void add(uint32_t row, const std::string& text);
+    void clear() { postings.clear(); }
+
+    // Candidate rows (ascending) for a folded query of >= MIN_QUERY chars
+    std::vector<uint32_t> candidates(const std::string& folded_query) const;
+
+    // The shortest posting list among the query's trigrams (also a
+    // superset of the matches), nullptr if some trigram occurs nowhere.
+    // Lets a paginated walk stop early instead of intersecting everything.
+    const std::vector<uint32_t>* shortest_list(const std::string& folded_query) const;
+
+private:
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+
+    static uint32_t key(const char* p) {
+        return (uint32_t)(unsigned char)p[0] << 16 | (uint32_t)(unsigned char)p[1] << 8 | (unsigned char)p[2];
+    }
+};
+
+#endif
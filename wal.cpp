@@ -0,0 +1,221 @@
+#include "wal.h"
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#define wal_fsync(fp) _commit(_fileno(fp))
+#else
+#include <unistd.h>
+#define wal_fsync(fp) fsync(fileno(fp))
+#endif
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// ==========================================
+// LIFECYCLE
+// ==========================================
+
+WriteAheadLog::WriteAheadLog(const string& p) : path(p) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        lock_guard<mutex> lock(log_mutex);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    if (flusher.joinable()) flusher.join();
+    if (file) fclose(file);
+}
+
+void WriteAheadLog::open_segment() {
+    file = fopen(path.c_str(), "ab");
+    if (!file) cerr << "[WAL] Cannot open " << path << endl;
+}
+
+void WriteAheadLog::start(uint64_t last_seq) {
+    next_seq = last_seq + 1;
+    pending_seq = durable_seq = last_seq;
+    open_segment();
+    flusher = thread(&WriteAheadLog::flush_loop, this);
+}
+
+// ==========================================
+// GROUP COMMIT
+// ==========================================
+
+uint64_t WriteAheadLog::append(const string& op, const json& payload) {
+    json record = {{"seq", 0}, {"op", op}, {"data", payload}};
+
+    lock_guard<mutex> lock(log_mutex);
+    uint64_t seq = next_seq++;
+    record["seq"] = seq;
+    pending += record.dump();
+    pending += '\n';
+    pending_seq = seq;
+    records_since_rotate++;
+    work_cv.notify_one();
+    return seq;
+}
+
+bool WriteAheadLog::wait_durable(uint64_t seq) {
+    unique_lock<mutex> lock(log_mutex);
+    durable_cv.wait(lock, [&] { return durable_seq >= seq || failed || stopping; });
+    return durable_seq >= seq;
+}
+
+void WriteAheadLog::flush_loop() {
+    // The flusher is the only thread touching 'file', so writes and
+    // rotations are naturally ordered by sequence number.
+    string batch;
+    while (true) {
+        uint64_t batch_seq;
+        bool rotating, broken;
+        {
+            unique_lock<mutex> lock(log_mutex);
+            work_cv.wait(lock, [&] { return !pending.empty() || rotate_requested || stopping; });
+            if (pending.empty() && !rotate_requested && stopping) return;
+            batch.swap(pending);
+            batch_seq = pending_seq;
+            rotating = rotate_requested;
+            broken = failed;
+        }
+
+        // After a failed write the segment may end in a partial record, so
+        // nothing is appended behind it; those records are never confirmed
+        bool written = true;
+        if (!batch.empty()) {
+            written = !broken && file && fwrite(batch.data(), 1, batch.size(), file) == batch.size() &&
+                      fflush(file) == 0 && wal_fsync(file) == 0;
+            if (!written && !broken) cerr << "[WAL] Write to " << path << " failed; mutations are no longer durable" << endl;
+        }
+        batch.clear();
+
+        if (rotating) {
+            if (file) fclose(file);
+            string rotated = path + ".1";
+            error_code ec;
+            if (fs::exists(rotated, ec)) {
+                // A previous compaction failed before discarding its segment:
+                // keep both by appending the live segment onto it.
+                ifstream in(path, ios::binary);
+                ofstream out(rotated, ios::binary | ios::app);
+                out << in.rdbuf();
+                in.close();
+                fs::remove(path, ec);
+            } else {
+                fs::rename(path, rotated, ec);
+            }
+            open_segment();
+        }
+
+        {
+            lock_guard<mutex> lock(log_mutex);
+            if (written) durable_seq = batch_seq;
+            else failed = true;
+            if (rotating) {
+                rotate_requested = false;
+                rotate_done = true;
+                records_since_rotate = 0;
+            }
+        }
+        durable_cv.notify_all();
+    }
+}
+
+// ==========================================
+// COMPACTION SUPPORT
+// ==========================================
+
+uint64_t WriteAheadLog::rotate() {
+    unique_lock<mutex> lock(log_mutex);
+    uint64_t last = next_seq - 1;
+    rotate_requested = true;
+    rotate_done = false;
+    work_cv.notify_one();
+    durable_cv.wait(lock, [&] { return rotate_done || stopping; });
+    return last;
+}
+
+void WriteAheadLog::discard_rotated() {
+    error_code ec;
+    fs::remove(path + ".1", ec);
+}
+
+size_t WriteAheadLog::pending_records() {
+    lock_guard<mutex> lock(log_mutex);
+    return records_since_rotate;
+}
+
+// ==========================================
+// RECOVERY
+// ==========================================
+
+uint64_t WriteAheadLog::replay(const string& p, uint64_t after_seq,
+                               const function<void(const string&, const json&)>& apply) {
+    ifstream in(p, ios::binary);
+    uint64_t last = after_seq;
+    if (!in.is_open()) return last;
+
+    string line;
+    size_t applied = 0;
+    uint64_t offset = 0;
+    uint64_t good_end = 0;          // just past the last intact record
+    bool torn = false;
+    bool unterminated = false;      // intact last record without its '\n'
+    while (getline(in, line)) {
+        bool terminated = !in.eof();
+        offset += line.size() + (terminated ? 1 : 0);
+        if (line.empty()) {
+            good_end = offset;
+            continue;
+        }
+        json record = json::parse(line, nullptr, false);
+        // A torn tail (crash mid-append) ends the usable log.
+        if (record.is_discarded() || !record.contains("seq")) {
+            torn = true;
+            break;
+        }
+        good_end = offset;
+        unterminated = !terminated;
+
+        uint64_t seq = record["seq"].get<uint64_t>();
+        if (seq <= after_seq) continue;
+        apply(record.value("op", ""), record["data"]);
+        last = seq;
+        applied++;
+    }
+    in.close();
+    if (applied) cout << "[WAL] Replayed " << applied << " records from " << p << endl;
+
+    // The segment is appended to again after startup: cut it back to its
+    // intact records so the next record starts on a line of its own
+    // instead of being glued onto the partial one (and lost with it).
+    error_code ec;
+    if (torn) {
+        cerr << "[WAL] Dropping torn tail of " << p << " after byte " << good_end << endl;
+        fs::resize_file(p, good_end, ec);
+        if (ec) cerr << "[WAL] Cannot truncate " << p << ": " << ec.message() << endl;
+    }
+    if (unterminated && !ec) {
+        ofstream out(p, ios::binary | ios::app);
+        out << '\n';
+    }
+    return last;
+}
+
+bool WriteAheadLog::write_atomically(const string& p, const string& contents) {
+    string tmp = p + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(contents.data(), 1, contents.size(), f) == contents.size();
+    ok = ok && fflush(f) == 0 && wal_fsync(f) == 0;
+    fclose(f);
+    if (!ok) return false;
+
+    error_code ec;
+    fs::rename(tmp, p, ec);
+    return !ec;
+}
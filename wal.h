@@ -0,0 +1,77 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <cstdio>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// ==============================
+// WRITE-AHEAD LOG
+// ==============================
+// Append-only mutation log (one JSON record per line).
+// Writers enqueue a record and then block in wait_durable() until the
+// background flusher has written + fsync'ed the batch containing it
+// (group commit: one fsync covers every record queued meanwhile).
+//
+// Compaction rotates the live segment to "<path>.1", writes a snapshot,
+// then discards the rotated segment. Replay reads "<path>.1" then "<path>".
+class WriteAheadLog {
+private:
+    std::string path;
+    std::FILE* file = nullptr;
+
+    std::mutex log_mutex;
+    std::condition_variable work_cv;     // flusher waits for records
+    std::condition_variable durable_cv;  // writers wait for fsync
+
+    std::string pending;                 // serialized, not yet written
+    uint64_t next_seq = 1;
+    uint64_t pending_seq = 0;            // highest seq inside 'pending'
+    uint64_t durable_seq = 0;            // highest seq fsync'ed to disk
+    bool failed = false;                 // a write/fsync failed: nothing more is confirmed
+    size_t records_since_rotate = 0;
+
+    bool rotate_requested = false;
+    bool rotate_done = false;
+    bool stopping = false;
+    std::thread flusher;
+
+    void flush_loop();
+    void open_segment();
+
+public:
+    explicit WriteAheadLog(const std::string& path);
+    ~WriteAheadLog();
+
+    // Starts the flusher. Sequence numbers continue after 'last_seq'.
+    void start(uint64_t last_seq);
+
+    // Queues a record and returns its sequence number (non-blocking).
+    uint64_t append(const std::string& op, const json& payload);
+
+    // Blocks until every record up to 'seq' is on disk. False if it never
+    // will be: the log hit an I/O error (sticky until restart) or is stopping.
+    bool wait_durable(uint64_t seq);
+
+    // Moves the live segment aside for compaction. Caller must hold the DB
+    // write lock so no append races the rotation. Returns the last seq in it.
+    uint64_t rotate();
+    void discard_rotated();
+    size_t pending_records();
+
+    // Applies every record with seq > after_seq. Returns the highest seq seen.
+    static uint64_t replay(const std::string& path, uint64_t after_seq,
+                           const std::function<void(const std::string&, const json&)>& apply);
+
+    // Writes a whole file via temp file + fsync + rename.
+    static bool write_atomically(const std::string& path, const std::string& contents);
+};
+
+#endif